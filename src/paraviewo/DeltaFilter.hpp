@@ -0,0 +1,52 @@
+#pragma once
+
+#include <hdf5.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace paraviewo
+{
+	/// Identifier of the delta filter. 32768-65535 is the range of the filters not registered with The HDF Group
+	/// (256-511 is reserved for testing).
+	const H5Z_filter_t DELTA_FILTER_ID = 38400;
+	/// Name of the delta filter, identifies it when another filter was registered with the same identifier
+	const char *const DELTA_FILTER_NAME = "paraviewo delta";
+
+	/// Delta coding of int64 values: x[i] - x[i - 1] when writing, prefix sum when reading
+	inline size_t delta_filter(unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[], size_t nbytes, size_t *, void **buf)
+	{
+		if (cd_nelmts < 1 || cd_values[0] != sizeof(int64_t) || nbytes % sizeof(int64_t) != 0)
+			return 0;
+
+		int64_t *values = static_cast<int64_t *>(*buf);
+		const size_t n = nbytes / sizeof(int64_t);
+
+		if (flags & H5Z_FLAG_REVERSE)
+		{
+			for (size_t i = 1; i < n; ++i)
+				values[i] += values[i - 1];
+		}
+		else
+		{
+			for (size_t i = n; i > 1; --i)
+				values[i - 1] -= values[i - 2];
+		}
+		return nbytes;
+	}
+
+	/// Filter class given to H5Zregister, and to HDF5 by the plugin (plugin/DeltaFilterPlugin.cpp).
+	/// Header only: the plugin does not link HDF5 nor paraviewo.
+	inline const H5Z_class2_t *delta_filter_class()
+	{
+		static const H5Z_class2_t filter = {
+			H5Z_CLASS_T_VERS,
+			DELTA_FILTER_ID,
+			1, 1,
+			DELTA_FILTER_NAME,
+			nullptr,
+			nullptr,
+			delta_filter};
+		return &filter;
+	}
+} // namespace paraviewo
@@ -0,0 +1,315 @@
+#include "FilteredWriter.hpp"
+
+#include <algorithm>
+
+namespace paraviewo
+{
+
+	FilteredWriter::FilteredWriter(ParaviewWriter &writer)
+		: writer_(writer), boundary_only_(false), weld_(false), weld_tolerance_(0), point_merge_(PointMerge::Average), prune_(false), clip_box_(false), reordering_(Reordering::None), cache_reordering_(false), in_session_(false), active_(false)
+	{
+	}
+
+	void FilteredWriter::set_welding(const bool weld, const double tolerance, const PointMerge merge)
+	{
+		weld_ = weld;
+		weld_tolerance_ = tolerance;
+		point_merge_ = merge;
+	}
+
+	void FilteredWriter::set_clip_box(const Eigen::Vector3d &min, const Eigen::Vector3d &max)
+	{
+		clip_box_ = true;
+		box_min_ = min;
+		box_max_ = max;
+	}
+
+	void FilteredWriter::set_reordering(const Reordering reordering, const bool cache)
+	{
+		reordering_ = reordering;
+		cache_reordering_ = cache;
+		point_order_.clear();
+		cell_order_.clear();
+	}
+
+	void FilteredWriter::reset_clip()
+	{
+		clip_box_ = false;
+		selected_ = nullptr;
+	}
+
+	void FilteredWriter::clear()
+	{
+		fields_.clear();
+		writer_.clear();
+	}
+
+	void FilteredWriter::filter(const Eigen::MatrixXd &points, const CellsView &input)
+	{
+		mesh_ = FilteredMesh();
+		active_ = false;
+
+		// The filters expect the VTK node order, the cells are converted first
+		const bool filtered = weld_ || prune_ || clip_box_ || selected_ || boundary_only_ || reordering_ != Reordering::None;
+		const bool permuted = filtered && node_ordering() != NodeOrdering::VTK;
+		if (permuted)
+			permute_nodes(input, node_ordering(), n_threads_, ordered_);
+		const CellsView cells = permuted ? CellsView(ordered_) : input;
+
+		// Welding keeps the cells and their order, the selection still applies to the input cells
+		if (weld_ || prune_)
+		{
+			weld_points(points, cells, weld_ ? weld_tolerance_ : -1, n_threads_, mesh_);
+			active_ = true;
+		}
+
+		if (clip_box_ || selected_)
+		{
+			const FilteredMesh previous = std::move(mesh_);
+			const Eigen::MatrixXd &input_points = active_ ? previous.points : points;
+			const CellsView input_cells = active_ ? CellsView(previous) : cells;
+
+			std::function<bool(const int64_t)> selected = selected_;
+			if (clip_box_)
+			{
+				const auto in_box = box_selector(input_points, input_cells, box_min_, box_max_);
+				if (selected_)
+					selected = [in_box, this](const int64_t c) { return in_box(c) && selected_(c); };
+				else
+					selected = in_box;
+			}
+
+			select_cells(input_points, input_cells, selected, n_threads_, mesh_);
+			if (active_)
+				mesh_.compose(previous);
+			active_ = true;
+		}
+
+		if (boundary_only_)
+		{
+			if (active_)
+			{
+				const FilteredMesh clipped = std::move(mesh_);
+				extract_boundary(clipped.points, CellsView(clipped), n_threads_, mesh_);
+				mesh_.compose(clipped);
+			}
+			else
+				extract_boundary(points, cells, n_threads_, mesh_);
+			active_ = true;
+		}
+
+		if (reordering_ != Reordering::None)
+		{
+			const FilteredMesh previous = std::move(mesh_);
+			const Eigen::MatrixXd &input_points = active_ ? previous.points : points;
+			const CellsView input_cells = active_ ? CellsView(previous) : cells;
+
+			const bool cached = cache_reordering_ && int64_t(point_order_.size()) == input_points.rows() && int64_t(cell_order_.size()) == input_cells.size();
+			if (!cached)
+				compute_reordering(input_points, input_cells, reordering_, n_threads_, point_order_, cell_order_);
+
+			reorder(input_points, input_cells, point_order_, cell_order_, n_threads_, mesh_);
+			if (active_)
+				mesh_.compose(previous);
+			active_ = true;
+		}
+
+		// Unfiltered cells go through untouched, the target converts them
+		writer_.set_node_ordering(active_ ? NodeOrdering::VTK : node_ordering());
+	}
+
+	void FilteredWriter::forward_field(const Field &field)
+	{
+		const FieldGenerator fill = field.fill ? field.fill : matrix_generator(field.data);
+
+		if (!active_)
+		{
+			if (field.is_point)
+				writer_.add_field(field.name, field.n_rows, field.n_components, fill);
+			else
+				writer_.add_cell_field(field.name, field.n_rows, field.n_components, fill);
+			return;
+		}
+
+		// Averages the rows of the welded points
+		if (field.is_point && point_merge_ == PointMerge::Average && !mesh_.merged_offsets.empty())
+		{
+			const FilteredMesh &mesh = mesh_;
+			const int n_components = field.n_components;
+			const FieldGenerator average = [fill, &mesh, n_components](const int64_t begin, const int64_t end, double *out) {
+				std::vector<double> row(n_components);
+				for (int64_t i = begin; i < end; ++i, out += n_components)
+				{
+					std::fill(out, out + n_components, 0.);
+					const int64_t first = mesh.merged_offsets[i], last = mesh.merged_offsets[i + 1];
+					for (int64_t k = first; k < last; ++k)
+					{
+						fill(mesh.merged_points[k], mesh.merged_points[k] + 1, row.data());
+						for (int d = 0; d < n_components; ++d)
+							out[d] += row[d];
+					}
+					for (int d = 0; d < n_components; ++d)
+						out[d] /= std::max<int64_t>(1, last - first);
+				}
+			};
+			writer_.add_field(field.name, mesh_.point_map.size(), n_components, average);
+			return;
+		}
+
+		// Gathers the rows of the input field
+		const std::vector<int64_t> &map = field.is_point ? mesh_.point_map : mesh_.cell_map;
+		const int n_components = field.n_components;
+		const FieldGenerator gather = [fill, &map, n_components](const int64_t begin, const int64_t end, double *out) {
+			for (int64_t i = begin; i < end; ++i)
+				fill(map[i], map[i] + 1, out + (i - begin) * n_components);
+		};
+
+		if (field.is_point)
+			writer_.add_field(field.name, map.size(), n_components, gather);
+		else
+			writer_.add_cell_field(field.name, map.size(), n_components, gather);
+	}
+
+	void FilteredWriter::forward_fields()
+	{
+		for (const auto &field : fields_)
+			forward_field(field);
+	}
+
+	void FilteredWriter::set_field_precision(const std::string &name, const FieldPrecision &precision)
+	{
+		ParaviewWriter::set_field_precision(name, precision);
+		writer_.set_field_precision(name, precision);
+	}
+
+	void FilteredWriter::set_default_precision(const FieldPrecision &precision)
+	{
+		ParaviewWriter::set_default_precision(precision);
+		writer_.set_default_precision(precision);
+	}
+
+	void FilteredWriter::add_scalar_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		add_vector_field(name, data);
+	}
+
+	void FilteredWriter::add_vector_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		if (in_session_)
+			forward_field({name, data.rows(), int(data.cols()), matrix_generator(data), true, Eigen::MatrixXd()});
+		else
+			fields_.push_back({name, data.rows(), int(data.cols()), nullptr, true, data});
+	}
+
+	void FilteredWriter::add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		add_vector_cell_field(name, data);
+	}
+
+	void FilteredWriter::add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		if (in_session_)
+			forward_field({name, data.rows(), int(data.cols()), matrix_generator(data), false, Eigen::MatrixXd()});
+		else
+			fields_.push_back({name, data.rows(), int(data.cols()), nullptr, false, data});
+	}
+
+	void FilteredWriter::add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point)
+	{
+		if (in_session_)
+			forward_field({name, n_rows, n_components, fill, is_point, Eigen::MatrixXd()});
+		else
+			fields_.push_back({name, n_rows, n_components, fill, is_point, Eigen::MatrixXd()});
+	}
+
+	template <typename Target>
+	bool FilteredWriter::write_filtered(Target &target, const bool begin)
+	{
+		if (mesh_.uniform())
+		{
+			const Eigen::MatrixXi cells = mesh_.cell_matrix();
+			const CellType ctype = mesh_.n_cells() > 0 ? mesh_.types[0] : CellType::Triangle;
+			return begin ? writer_.begin_mesh(target, mesh_.points, cells, ctype) : writer_.write_mesh(target, mesh_.points, cells, ctype);
+		}
+
+		const std::vector<CellElement> cells = mesh_.cell_elements();
+		return begin ? writer_.begin_mesh(target, mesh_.points, cells) : writer_.write_mesh(target, mesh_.points, cells);
+	}
+
+	bool FilteredWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		filter(points, CellsView(cells, ctype));
+		forward_fields();
+		const bool ok = active_ ? write_filtered(path, false) : writer_.write_mesh(path, points, cells, ctype);
+		clear();
+		return ok;
+	}
+
+	bool FilteredWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		filter(points, CellsView(cells));
+		forward_fields();
+		const bool ok = active_ ? write_filtered(path, false) : writer_.write_mesh(path, points, cells);
+		clear();
+		return ok;
+	}
+
+	bool FilteredWriter::write_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		filter(points, CellsView(cells, ctype));
+		forward_fields();
+		const bool ok = active_ ? write_filtered(sink, false) : writer_.write_mesh(sink, points, cells, ctype);
+		clear();
+		return ok;
+	}
+
+	bool FilteredWriter::write_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		filter(points, CellsView(cells));
+		forward_fields();
+		const bool ok = active_ ? write_filtered(sink, false) : writer_.write_mesh(sink, points, cells);
+		clear();
+		return ok;
+	}
+
+	bool FilteredWriter::begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		end_mesh();
+		filter(points, CellsView(cells, ctype));
+		in_session_ = true;
+		return active_ ? write_filtered(path, true) : writer_.begin_mesh(path, points, cells, ctype);
+	}
+
+	bool FilteredWriter::begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		end_mesh();
+		filter(points, CellsView(cells));
+		in_session_ = true;
+		return active_ ? write_filtered(path, true) : writer_.begin_mesh(path, points, cells);
+	}
+
+	bool FilteredWriter::begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		end_mesh();
+		filter(points, CellsView(cells, ctype));
+		in_session_ = true;
+		return active_ ? write_filtered(sink, true) : writer_.begin_mesh(sink, points, cells, ctype);
+	}
+
+	bool FilteredWriter::begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		end_mesh();
+		filter(points, CellsView(cells));
+		in_session_ = true;
+		return active_ ? write_filtered(sink, true) : writer_.begin_mesh(sink, points, cells);
+	}
+
+	bool FilteredWriter::end_mesh()
+	{
+		if (!in_session_)
+			return false;
+
+		in_session_ = false;
+		return writer_.end_mesh();
+	}
+} // namespace paraviewo
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ParaviewWriter.hpp"
+#include "MeshFilters.hpp"
+
+#include <Eigen/Dense>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Transforms the mesh before handing it to another writer (e.g., VTUWriter or HDF5VTUWriter).
+	/// Point and cell fields are remapped to the transformed mesh while the target encodes them, without copies.
+	/// Cells in another node order (set_node_ordering) are converted before the filters, the ordering of the target
+	/// is set at every write.
+	class FilteredWriter : public ParaviewWriter
+	{
+	public:
+		using ParaviewWriter::write_mesh;
+
+		/// writer must outlive this object
+		FilteredWriter(ParaviewWriter &writer);
+
+		/// Welds the points closer than tolerance (0: identical coordinates) and drops the points no cell uses, before
+		/// the other filters (e.g., discontinuous or per element output). Point fields take the average of the welded
+		/// values or the value of the first one. See weld_points.
+		void set_welding(const bool weld, const double tolerance = 0, const PointMerge merge = PointMerge::Average);
+		/// Only drops the points no cell uses
+		inline void set_pruning(const bool prune) { prune_ = prune; }
+
+		/// Writes only the boundary surface of the volume cells, see extract_boundary
+		inline void set_boundary_only(const bool boundary_only) { boundary_only_ = boundary_only; }
+
+		/// Region of interest: only the cells whose centroid is in the box [min, max] are written, with their points.
+		/// Applied before the boundary extraction.
+		void set_clip_box(const Eigen::Vector3d &min, const Eigen::Vector3d &max);
+		/// Only the cells for which selected(cell) is true are written, selected must be thread safe.
+		/// Combined with the box if both are set.
+		inline void set_cell_selection(const std::function<bool(const int64_t cell)> &selected) { selected_ = selected; }
+		/// Removes the box and the cell selection
+		void reset_clip();
+
+		/// Renumbers the points and cells (after clipping and boundary extraction) to improve locality, which helps the
+		/// compression and the rendering. With cache the permutation is computed once and reused as long as the number
+		/// of points and cells does not change: the mesh must be static.
+		void set_reordering(const Reordering reordering, const bool cache = false);
+
+		/// Also set on the target writer, which encodes the fields
+		void set_field_precision(const std::string &name, const FieldPrecision &precision) override;
+		void set_default_precision(const FieldPrecision &precision) override;
+
+		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
+		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
+
+		bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
+		bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
+
+		bool begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
+		bool begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
+		bool begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
+		bool begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
+		bool end_mesh() override;
+
+		void clear() override;
+		bool uses_hdf5() const override { return writer_.uses_hdf5(); }
+
+	protected:
+		void add_scalar_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point) override;
+
+	private:
+		struct Field
+		{
+			std::string name;
+			int64_t n_rows;
+			int n_components;
+			FieldGenerator fill;
+			bool is_point;
+			Eigen::MatrixXd data;
+		};
+
+		ParaviewWriter &writer_;
+		bool boundary_only_;
+
+		bool weld_;
+		double weld_tolerance_;
+		PointMerge point_merge_;
+		bool prune_;
+
+		bool clip_box_;
+		Eigen::Vector3d box_min_;
+		Eigen::Vector3d box_max_;
+		std::function<bool(const int64_t cell)> selected_;
+
+		Reordering reordering_;
+		bool cache_reordering_;
+		std::vector<int64_t> point_order_;
+		std::vector<int64_t> cell_order_;
+
+		bool in_session_;
+		std::vector<Field> fields_;
+
+		/// Transformed mesh, active is false when no filter applies and the input goes through untouched
+		bool active_;
+		FilteredMesh mesh_;
+		/// Input cells in the VTK node order, when they are in another order and filtered
+		FilteredMesh ordered_;
+
+		void filter(const Eigen::MatrixXd &points, const CellsView &cells);
+		void forward_field(const Field &field);
+		void forward_fields();
+
+		/// Hands the transformed mesh to writer_ (write_mesh, or begin_mesh with begin), target is a path or a Sink
+		template <typename Target>
+		bool write_filtered(Target &target, const bool begin);
+	};
+} // namespace paraviewo
@@ -0,0 +1,218 @@
+#include "HDF5CollectionWriter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace paraviewo
+{
+	HDF5CollectionWriter::HDF5CollectionWriter(const Type type)
+		: type_(type), transient_(false), static_mesh_(false), n_steps_(0)
+	{
+	}
+
+	HDF5CollectionWriter::~HDF5CollectionWriter()
+	{
+		close();
+	}
+
+	bool HDF5CollectionWriter::open(const std::string &path, const bool transient)
+	{
+		close();
+
+		file_ = std::make_unique<HDF5File>();
+		if (!writer_.create_file(path, false, *file_))
+		{
+			file_.reset();
+			return false;
+		}
+
+		transient_ = transient;
+		file_->set_append(transient_);
+
+		const std::array<int64_t, 2> version = {{2, 1}};
+		file_->write_attribute("VTKHDF", "Version", version.data(), version.size());
+		file_->write_attribute("VTKHDF", "Type", type_ == Type::PartitionedDataSetCollection ? "PartitionedDataSetCollection" : "MultiBlockDataSet");
+		file_->create_group("VTKHDF/Assembly");
+		return true;
+	}
+
+	bool HDF5CollectionWriter::close()
+	{
+		if (!file_)
+			return true;
+
+		const bool ok = file_->close();
+		file_.reset();
+		blocks_.clear();
+		n_steps_ = 0;
+		return ok;
+	}
+
+	void HDF5CollectionWriter::begin_step(const double time)
+	{
+		if (!file_ || !transient_)
+			throw std::logic_error("begin_step requires a transient file");
+
+		++n_steps_;
+		file_->write_dataset("VTKHDF/Steps/Values", &time, {1});
+		file_->write_attribute("VTKHDF/Steps", "NSteps", &n_steps_, 1);
+	}
+
+	HDF5CollectionWriter::Block *HDF5CollectionWriter::prepare_block(const std::string &path)
+	{
+		if (!file_)
+			throw std::logic_error("No open collection");
+		if (transient_ && n_steps_ == 0)
+			throw std::logic_error("begin_step must be called before writing blocks");
+
+		auto it = blocks_.find(path);
+		if (it == blocks_.end())
+		{
+			const size_t slash = path.find_last_of('/');
+			const std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+			if (name.empty())
+				throw std::invalid_argument("Invalid block name " + path);
+
+			Block block;
+			block.index = blocks_.size();
+			// Leaves with the same name (e.g., "fluid/inlet" and "solid/inlet") get distinct groups
+			block.group = "VTKHDF/" + name;
+			while (block.group == "VTKHDF/Assembly" || block.group == "VTKHDF/Steps" || group_taken(block.group))
+				block.group += "_" + std::to_string(block.index);
+			block.step = -1;
+			block.has_geometry = false;
+
+			file_->create_group(block.group);
+			file_->write_attribute(block.group, "Index", &block.index, 1);
+			file_->create_soft_link("/" + block.group, "VTKHDF/Assembly/" + path);
+			it = blocks_.emplace(path, block).first;
+		}
+
+		// The step of a non transient file is 0
+		Block &block = it->second;
+		const int step = std::max(0, n_steps_ - 1);
+		if (block.step == step)
+			return nullptr;
+		block.step = step;
+		return &block;
+	}
+
+	bool HDF5CollectionWriter::group_taken(const std::string &group) const
+	{
+		for (const auto &b : blocks_)
+		{
+			if (b.second.group == group)
+				return true;
+		}
+		return false;
+	}
+
+	std::map<std::string, hsize_t> HDF5CollectionWriter::geometry_rows(const Block &block) const
+	{
+		std::map<std::string, hsize_t> rows;
+		for (const std::string name : {"NumberOfPoints", "Points", "Types", "Connectivity"})
+			rows[name] = file_->dataset_rows(block.group + "/" + name);
+		return rows;
+	}
+
+	void HDF5CollectionWriter::write_steps(const Block &block, const int64_t n_points, const int64_t n_cells, const bool with_geometry, const std::map<std::string, hsize_t> &rows)
+	{
+		// Static geometry: every step points to the parts written first
+		const auto offset = [&](const std::string &name) -> int64_t { return with_geometry ? rows.at(name) : 0; };
+		const std::string steps = block.group + "/Steps";
+		const auto append = [&](const std::string &name, const int64_t value) { file_->write_dataset(steps + "/" + name, &value, {1}); };
+
+		append("PartOffsets", offset("NumberOfPoints"));
+		append("NumberOfParts", 1);
+		append("PointOffsets", offset("Points"));
+		append("CellOffsets", offset("Types"));
+		append("ConnectivityIdOffsets", offset("Connectivity"));
+
+		// The fields of the step are the last rows of their datasets
+		for (const std::string &name : file_->list_group(block.group + "/PointData"))
+			append("PointDataOffsets/" + name, file_->dataset_rows(block.group + "/PointData/" + name) - n_points);
+		for (const std::string &name : file_->list_group(block.group + "/CellData"))
+			append("CellDataOffsets/" + name, file_->dataset_rows(block.group + "/CellData/" + name) - n_cells);
+
+		file_->write_attribute(steps, "NSteps", &n_steps_, 1);
+	}
+
+	bool HDF5CollectionWriter::write_block(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		Block *block = prepare_block(path);
+		if (!block)
+			return false;
+
+		const bool with_geometry = !(transient_ && static_mesh_ && block->has_geometry);
+		const auto rows = geometry_rows(*block);
+		writer_.write_group(*file_, block->group, points, cells, ctype, with_geometry);
+
+		if (transient_)
+			write_steps(*block, points.rows(), cells.rows(), with_geometry, rows);
+		block->has_geometry = true;
+		return true;
+	}
+
+	bool HDF5CollectionWriter::write_block(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		Block *block = prepare_block(path);
+		if (!block)
+			return false;
+
+		const bool with_geometry = !(transient_ && static_mesh_ && block->has_geometry);
+		const auto rows = geometry_rows(*block);
+		writer_.write_group(*file_, block->group, points, cells, with_geometry);
+
+		if (transient_)
+			write_steps(*block, points.rows(), cells.size(), with_geometry, rows);
+		block->has_geometry = true;
+		return true;
+	}
+
+	void HDF5CollectionWriter::set_field_precision(const std::string &name, const FieldPrecision &precision)
+	{
+		FieldWriter::set_field_precision(name, precision);
+		writer_.set_field_precision(name, precision);
+	}
+
+	void HDF5CollectionWriter::set_default_precision(const FieldPrecision &precision)
+	{
+		FieldWriter::set_default_precision(precision);
+		writer_.set_default_precision(precision);
+	}
+
+	void HDF5CollectionWriter::clear()
+	{
+		writer_.clear();
+	}
+
+	void HDF5CollectionWriter::add_scalar_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		writer_.add_field(name, data);
+	}
+
+	void HDF5CollectionWriter::add_vector_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		writer_.add_field(name, data);
+	}
+
+	void HDF5CollectionWriter::add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		writer_.add_cell_field(name, data);
+	}
+
+	void HDF5CollectionWriter::add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		writer_.add_cell_field(name, data);
+	}
+
+	void HDF5CollectionWriter::add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point)
+	{
+		writer_.set_num_threads(n_threads_);
+		if (is_point)
+			writer_.add_field(name, n_rows, n_components, fill);
+		else
+			writer_.add_cell_field(name, n_rows, n_components, fill);
+	}
+} // namespace paraviewo
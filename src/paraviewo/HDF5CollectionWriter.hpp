@@ -0,0 +1,105 @@
+#pragma once
+
+#include "HDF5VTUWriter.hpp"
+
+#include <Eigen/Dense>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Several unstructured blocks in one VTKHDF file (PartitionedDataSetCollection or MultiBlockDataSet), instead
+	/// of a .vtm referencing one file per block. Every block is an UnstructuredGrid group /VTKHDF/<name>, placed in
+	/// the assembly hierarchy by its path ("fluid/inlet" is the block "inlet" in the node "fluid"). Blocks are
+	/// identified by their path, a name already used by another block gets the suffix _<index> in its group.
+	///
+	/// A transient file holds a time series: every begin_step appends the blocks of the step to the datasets and
+	/// records their offsets in the Steps groups. All the blocks, with the same fields, must be written at every step.
+	///
+	/// HDF5CollectionWriter writer;
+	/// writer.open("sim.hdf", true);
+	/// for (...)
+	/// {
+	///     writer.begin_step(t);
+	///     writer.add_field("p", p_fluid);
+	///     writer.write_block("fluid", v_fluid, f_fluid, CellType::Tetrahedron);
+	///     writer.add_field("u", u_solid);
+	///     writer.write_block("solid", v_solid, f_solid, CellType::Hexahedron);
+	/// }
+	/// writer.close();
+	class HDF5CollectionWriter : public FieldWriter
+	{
+	public:
+		enum class Type
+		{
+			PartitionedDataSetCollection,
+			MultiBlockDataSet
+		};
+
+		HDF5CollectionWriter(const Type type = Type::PartitionedDataSetCollection);
+		~HDF5CollectionWriter();
+
+		/// Creates the file with the settings of block_writer()
+		bool open(const std::string &path, const bool transient = false);
+		bool close();
+
+		/// Writer encoding the blocks, its settings (compression, index preconditioning, ...) apply to all blocks
+		inline HDF5VTUWriter &block_writer() { return writer_; }
+
+		/// Transient files: blocks keep the geometry of their first step, only the fields are appended
+		inline void set_static_mesh(const bool static_mesh) { static_mesh_ = static_mesh; }
+
+		/// Transient files: starts a new time step
+		void begin_step(const double time);
+
+		/// Writes the fields added since the last block and the mesh as the block at path
+		bool write_block(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype);
+		bool write_block(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells);
+
+		/// Also set on the block writer
+		void set_field_precision(const std::string &name, const FieldPrecision &precision) override;
+		void set_default_precision(const FieldPrecision &precision) override;
+
+		bool uses_hdf5() const override { return true; }
+		void clear() override;
+
+	protected:
+		void add_scalar_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point) override;
+
+	private:
+		struct Block
+		{
+			std::string group;
+			int index;
+			/// Last step the block was written in
+			int step;
+			bool has_geometry;
+		};
+
+		Type type_;
+		HDF5VTUWriter writer_;
+		std::unique_ptr<HDF5File> file_;
+
+		bool transient_;
+		bool static_mesh_;
+		int n_steps_;
+		/// Blocks by assembly path
+		std::map<std::string, Block> blocks_;
+
+		/// Block at path (created on first use), nullptr if it was already written in this step
+		Block *prepare_block(const std::string &path);
+		bool group_taken(const std::string &group) const;
+		/// Rows of the geometry datasets of the block, the offsets of the step
+		std::map<std::string, hsize_t> geometry_rows(const Block &block) const;
+		void write_steps(const Block &block, const int64_t n_points, const int64_t n_cells, const bool with_geometry, const std::map<std::string, hsize_t> &rows);
+	};
+} // namespace paraviewo
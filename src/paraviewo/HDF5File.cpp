@@ -0,0 +1,696 @@
+#include "HDF5File.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace paraviewo
+{
+	namespace
+	{
+		// Datasets smaller than this are stored contiguously and never compressed
+		const size_t MIN_CHUNKED_BYTES = 4096;
+		// Target size of a chunk
+		const size_t CHUNK_BYTES = 1 << 20;
+		// Levels tried by the adaptive compression, from the fastest
+		const int ADAPTIVE_LEVELS[] = {1, 3, 6, 9};
+		// A slower level is only chosen if it improves the ratio by this factor
+		const double ADAPTIVE_MIN_GAIN = 1.05;
+
+		void check(const herr_t status, const std::string &what)
+		{
+			if (status < 0)
+				throw std::runtime_error("HDF5 error: " + what);
+		}
+
+		// Another filter registered with our identifier must not encode (nor decode) the index arrays
+		bool registered_delta_filter_is_ours()
+		{
+			unsigned int config = 0;
+			if (H5Zget_filter_info(DELTA_FILTER_ID, &config) < 0 || !(config & H5Z_FILTER_CONFIG_ENCODE_ENABLED) || !(config & H5Z_FILTER_CONFIG_DECODE_ENABLED))
+				return false;
+
+			// The name of a filter is only exposed through a pipeline using it
+			const hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+			const hsize_t chunk = 1;
+			const unsigned int element_size = sizeof(int64_t);
+			H5Pset_chunk(dcpl, 1, &chunk);
+
+			unsigned int flags, filter_config, cd_values[1];
+			size_t cd_nelmts = 1;
+			char name[64] = {0};
+			const bool ours = H5Pset_filter(dcpl, DELTA_FILTER_ID, H5Z_FLAG_OPTIONAL, 1, &element_size) >= 0
+							  && H5Pget_filter_by_id2(dcpl, DELTA_FILTER_ID, &flags, &cd_nelmts, cd_values, sizeof(name), name, &filter_config) >= 0
+							  && std::strcmp(name, DELTA_FILTER_NAME) == 0;
+			H5Pclose(dcpl);
+			return ours;
+		}
+
+		// File image callbacks of in-memory files: the core driver allocates through them, so that its buffer is known
+		template <typename Image>
+		H5FD_file_image_callbacks_t core_image_callbacks(Image *image)
+		{
+			H5FD_file_image_callbacks_t callbacks;
+			callbacks.image_malloc = [](size_t size, H5FD_file_image_op_t, void *udata) -> void * {
+				Image *image = static_cast<Image *>(udata);
+				image->buffer = std::malloc(size);
+				image->size = image->buffer ? size : 0;
+				return image->buffer;
+			};
+			callbacks.image_memcpy = [](void *dest, const void *src, size_t size, H5FD_file_image_op_t, void *) -> void * {
+				return std::memcpy(dest, src, size);
+			};
+			callbacks.image_realloc = [](void *ptr, size_t size, H5FD_file_image_op_t, void *udata) -> void * {
+				Image *image = static_cast<Image *>(udata);
+				void *buffer = std::realloc(ptr, size);
+				if (buffer && ptr == image->buffer)
+				{
+					image->buffer = buffer;
+					image->size = size;
+				}
+				return buffer;
+			};
+			callbacks.image_free = [](void *ptr, H5FD_file_image_op_t op, void *udata) -> herr_t {
+				Image *image = static_cast<Image *>(udata);
+				if (ptr == image->buffer && op == H5FD_FILE_IMAGE_OP_FILE_CLOSE && image->keep)
+					return 0;
+				if (ptr == image->buffer)
+				{
+					image->buffer = nullptr;
+					image->size = 0;
+				}
+				std::free(ptr);
+				return 0;
+			};
+			callbacks.udata_copy = [](void *udata) { return udata; };
+			callbacks.udata_free = [](void *) -> herr_t { return 0; };
+			callbacks.udata = image;
+			return callbacks;
+		}
+	} // namespace
+
+	bool register_delta_filter()
+	{
+		// Already registered, or found by HDF5 among the plugins
+		if (H5Zfilter_avail(DELTA_FILTER_ID) > 0)
+			return registered_delta_filter_is_ours();
+
+		return H5Zregister(delta_filter_class()) >= 0;
+	}
+
+	std::mutex &hdf5_mutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	HDF5File::HDF5File()
+		: file_(-1), lcpl_(-1), compression_level_(0), adaptive_target_(0), index_preconditioning_(IndexPreconditioning::None), latest_format_(false), page_size_(0), memory_increment_(16 << 20), reuse_datasets_(false), workspace_(&own_workspace_), append_(false)
+	{
+	}
+
+	HDF5File::~HDF5File()
+	{
+		close();
+	}
+
+	bool HDF5File::create(const std::string &path, const hid_t fapl)
+	{
+		close();
+
+		// No modification times on the root group either (stored by the latest format)
+		const hid_t fcpl = H5Pcreate(H5P_FILE_CREATE);
+		H5Pset_obj_track_times(fcpl, false);
+		if (page_size_ > 0)
+		{
+			H5Pset_file_space_strategy(fcpl, H5F_FSPACE_STRATEGY_PAGE, 0, 1);
+			H5Pset_file_space_page_size(fcpl, page_size_);
+		}
+		if (latest_format_)
+			H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+
+		file_ = H5Fcreate(path.c_str(), H5F_ACC_TRUNC, fcpl, fapl);
+		H5Pclose(fcpl);
+
+		lcpl_ = H5Pcreate(H5P_LINK_CREATE);
+		H5Pset_create_intermediate_group(lcpl_, 1);
+
+		return is_open();
+	}
+
+	bool HDF5File::create(const std::string &path)
+	{
+		const hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+		const bool ok = create(path, fapl);
+		H5Pclose(fapl);
+
+		return ok;
+	}
+
+	bool HDF5File::create_in_memory(const std::string &name, const bool backing_store)
+	{
+		const hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+		H5Pset_fapl_core(fapl, memory_increment_, backing_store);
+		close();
+		if (!backing_store)
+		{
+			H5FD_file_image_callbacks_t callbacks = core_image_callbacks(&core_image_);
+			core_image_.tracked = H5Pset_file_image_callbacks(fapl, &callbacks) >= 0;
+		}
+		const bool ok = create(name, fapl);
+		H5Pclose(fapl);
+
+		return ok;
+	}
+
+	bool HDF5File::create_vtkhdf(const std::string &path, const bool in_memory, const HDF5FileSettings &settings, Workspace *workspace)
+	{
+		set_latest_format(settings.latest_format);
+		set_page_size(settings.page_size);
+		set_workspace(workspace);
+
+		bool ok;
+		if (in_memory)
+			ok = create_in_memory(path);
+		else if (settings.core_staging)
+			ok = create_in_memory(path, true);
+		else
+			ok = create(path);
+
+		if (!ok)
+			return false;
+
+		set_compression_level(settings.compression_level);
+		set_index_preconditioning(settings.index_preconditioning);
+		create_group("VTKHDF");
+		return true;
+	}
+
+	bool HDF5File::close()
+	{
+		if (!is_open())
+			return true;
+
+		for (const auto &d : datasets_)
+			H5Dclose(d.second.id);
+		datasets_.clear();
+		first_rows_.clear();
+
+		H5Pclose(lcpl_);
+		lcpl_ = -1;
+
+		const herr_t status = H5Fclose(file_);
+		file_ = -1;
+		core_image_.tracked = false;
+		return status >= 0;
+	}
+
+	void HDF5File::create_group(const std::string &path)
+	{
+		if (exists(path))
+			return;
+
+		// No modification times: the same content gives the same bytes
+		const hid_t gcpl = H5Pcreate(H5P_GROUP_CREATE);
+		H5Pset_obj_track_times(gcpl, false);
+		const hid_t group = H5Gcreate2(file_, path.c_str(), lcpl_, gcpl, H5P_DEFAULT);
+		H5Pclose(gcpl);
+		if (group < 0)
+			throw std::runtime_error("HDF5 error: unable to create group " + path);
+		H5Gclose(group);
+	}
+
+	hid_t HDF5File::dataset_creation_plist(const hid_t type, const std::vector<hsize_t> &dims, const std::vector<hsize_t> &chunk, const int level, const bool index) const
+	{
+		const hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+		H5Pset_obj_track_times(dcpl, false);
+
+		size_t size = H5Tget_size(type);
+		for (const hsize_t d : dims)
+			size *= d;
+
+		// Reused datasets must be chunked to be resizable
+		const bool compress = level > 0 && size >= MIN_CHUNKED_BYTES && H5Zfilter_avail(H5Z_FILTER_DEFLATE);
+		const bool forced = !chunk.empty() && size >= MIN_CHUNKED_BYTES;
+		if (!compress && !reuse_datasets_ && !forced)
+			return dcpl;
+
+		std::vector<hsize_t> chunk_dims = dims;
+		if (!chunk.empty())
+		{
+			assert(chunk.size() == dims.size());
+			for (size_t i = 0; i < dims.size(); ++i)
+				chunk_dims[i] = std::max<hsize_t>(1, std::min(dims[i], chunk[i]));
+		}
+		else
+		{
+			// Chunk along the first dimension only, rows are never split
+			size_t row_size = H5Tget_size(type);
+			for (size_t i = 1; i < dims.size(); ++i)
+				row_size *= dims[i];
+
+			// Reused datasets are resized by the next writes: the chunk only depends on the row width, not on the
+			// first shape (small arrays, e.g., the counts, get small chunks to not allocate a whole chunk each)
+			const size_t chunk_bytes = reuse_datasets_ && size < MIN_CHUNKED_BYTES ? MIN_CHUNKED_BYTES : CHUNK_BYTES;
+			const hsize_t rows = std::max<hsize_t>(1, chunk_bytes / std::max<size_t>(1, row_size));
+			chunk_dims[0] = reuse_datasets_ ? rows : std::min<hsize_t>(dims[0], rows);
+		}
+		for (hsize_t &c : chunk_dims)
+			c = std::max<hsize_t>(1, c);
+
+		H5Pset_chunk(dcpl, chunk_dims.size(), chunk_dims.data());
+		if (compress)
+		{
+			if (index && index_preconditioning_ == IndexPreconditioning::ScaleOffset)
+				H5Pset_scaleoffset(dcpl, H5Z_SO_INT, H5Z_SO_INT_MINBITS_DEFAULT);
+			else
+			{
+				if (index && index_preconditioning_ == IndexPreconditioning::Delta && register_delta_filter())
+				{
+					const unsigned int element_size = sizeof(int64_t);
+					H5Pset_filter(dcpl, DELTA_FILTER_ID, H5Z_FLAG_MANDATORY, 1, &element_size);
+				}
+				H5Pset_shuffle(dcpl);
+			}
+			H5Pset_deflate(dcpl, level);
+		}
+
+		return dcpl;
+	}
+
+	hid_t HDF5File::create_dataset(const std::string &path, const hid_t type, const std::vector<hsize_t> &dims, const std::vector<hsize_t> &chunk)
+	{
+		return create_dataset(path, type, dims, chunk, compression_level_, false);
+	}
+
+	hid_t HDF5File::create_dataset(const std::string &path, const hid_t type, const std::vector<hsize_t> &dims, const std::vector<hsize_t> &chunk, const int compression_level)
+	{
+		return create_dataset(path, type, dims, chunk, compression_level, false);
+	}
+
+	int HDF5File::choose_compression_level(const hid_t type, const void *sample, const hsize_t n, ArrayCompression &choice) const
+	{
+		choice.level = 0;
+		choice.ratio = 1;
+		choice.mb_per_s = 0;
+
+		const size_t bytes = n * H5Tget_size(type);
+		if (bytes < MIN_CHUNKED_BYTES || !H5Zfilter_avail(H5Z_FILTER_DEFLATE))
+			return choice.level;
+
+		const hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+		H5Pset_fapl_core(fapl, 2 * bytes, false);
+		const hid_t scratch = H5Fcreate("paraviewo_sample", H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+		H5Pclose(fapl);
+		if (scratch < 0)
+			return choice.level;
+
+		const hid_t space = H5Screate_simple(1, &n, nullptr);
+		for (const int level : ADAPTIVE_LEVELS)
+		{
+			const hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+			H5Pset_chunk(dcpl, 1, &n);
+			if (H5Tget_size(type) > 1)
+				H5Pset_shuffle(dcpl);
+			H5Pset_deflate(dcpl, level);
+
+			const hid_t dset = H5Dcreate2(scratch, std::to_string(level).c_str(), type, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+			H5Pclose(dcpl);
+
+			// The chunk is compressed when flushed
+			const auto start = std::chrono::steady_clock::now();
+			H5Dwrite(dset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, sample);
+			H5Dflush(dset);
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			const hsize_t stored = std::max<hsize_t>(1, H5Dget_storage_size(dset));
+			H5Dclose(dset);
+
+			const double ratio = double(bytes) / stored;
+			const double mb_per_s = bytes / std::max(seconds, 1e-9) / 1e6;
+
+			// Higher levels are only slower
+			if (mb_per_s < adaptive_target_)
+				break;
+			if (ratio >= choice.ratio * ADAPTIVE_MIN_GAIN)
+			{
+				choice.level = level;
+				choice.ratio = ratio;
+				choice.mb_per_s = mb_per_s;
+			}
+		}
+		H5Sclose(space);
+		H5Fclose(scratch);
+
+		return choice.level;
+	}
+
+	hid_t HDF5File::create_index_dataset(const std::string &path, const hsize_t size)
+	{
+		return create_dataset(path, H5T_NATIVE_INT64, {size}, {}, compression_level_, true);
+	}
+
+	void HDF5File::write_index_dataset(const std::string &path, const int64_t *data, const hsize_t size)
+	{
+		const hid_t dset = create_index_dataset(path, size);
+		write_rows(dset, H5T_NATIVE_INT64, data, 0, size);
+		release_dataset(dset);
+	}
+
+	hid_t HDF5File::create_dataset(const std::string &path, const hid_t type, const std::vector<hsize_t> &dims, const std::vector<hsize_t> &chunk, const int level, const bool index)
+	{
+		if (reuse_datasets_)
+		{
+			const auto it = datasets_.find(path);
+			if (it != datasets_.end())
+			{
+				CachedDataset &d = it->second;
+
+				const hid_t dtype = H5Dget_type(d.id);
+				const bool same_type = H5Tequal(dtype, type) > 0;
+				H5Tclose(dtype);
+
+				if (append_ && same_type && d.dims.size() == dims.size() && std::equal(dims.begin() + 1, dims.end(), d.dims.begin() + 1))
+				{
+					std::vector<hsize_t> extent = d.dims;
+					extent[0] += dims[0];
+					check(H5Dset_extent(d.id, extent.data()), "unable to extend dataset " + path);
+
+					first_rows_[d.id] = d.dims[0];
+					d.dims = extent;
+					d.used = true;
+					return d.id;
+				}
+
+				if (!append_ && same_type && d.dims.size() == dims.size() && (d.dims == dims || H5Dset_extent(d.id, dims.data()) >= 0))
+				{
+					d.dims = dims;
+					d.used = true;
+					return d.id;
+				}
+
+				// Cannot be reused, start over
+				H5Dclose(d.id);
+				H5Ldelete(file_, path.c_str(), H5P_DEFAULT);
+				datasets_.erase(it);
+			}
+		}
+
+		std::vector<hsize_t> max_dims = dims;
+		max_dims[0] = H5S_UNLIMITED;
+
+		const hid_t space = H5Screate_simple(dims.size(), dims.data(), reuse_datasets_ ? max_dims.data() : nullptr);
+		const hid_t dcpl = dataset_creation_plist(type, dims, chunk, level, index);
+
+		// Room for a full chunk being filled column by column
+		const hid_t dapl = H5Pcreate(H5P_DATASET_ACCESS);
+		H5Pset_chunk_cache(dapl, H5D_CHUNK_CACHE_NSLOTS_DEFAULT, 2 * CHUNK_BYTES, H5D_CHUNK_CACHE_W0_DEFAULT);
+
+		const hid_t dset = H5Dcreate2(file_, path.c_str(), type, space, lcpl_, dcpl, dapl);
+
+		H5Pclose(dapl);
+		H5Pclose(dcpl);
+		H5Sclose(space);
+
+		if (dset < 0)
+			throw std::runtime_error("HDF5 error: unable to create dataset " + path);
+
+		if (reuse_datasets_)
+			datasets_[path] = {dset, dims, true};
+
+		return dset;
+	}
+
+	hsize_t HDF5File::first_row(const hid_t dset) const
+	{
+		const auto it = first_rows_.find(dset);
+		return it == first_rows_.end() ? 0 : it->second;
+	}
+
+	void HDF5File::release_dataset(const hid_t dset)
+	{
+		if (!reuse_datasets_)
+			H5Dclose(dset);
+	}
+
+	hsize_t HDF5File::block_rows(const hid_t dset) const
+	{
+		const hid_t dcpl = H5Dget_create_plist(dset);
+		hsize_t chunk[H5S_MAX_RANK];
+		const bool chunked = H5Pget_layout(dcpl) == H5D_CHUNKED && H5Pget_chunk(dcpl, H5S_MAX_RANK, chunk) > 0;
+		H5Pclose(dcpl);
+
+		if (chunked)
+			return chunk[0];
+
+		const hid_t space = H5Dget_space(dset);
+		hsize_t dims[H5S_MAX_RANK];
+		const int rank = H5Sget_simple_extent_dims(space, dims, nullptr);
+		H5Sclose(space);
+
+		const hid_t type = H5Dget_type(dset);
+		size_t row_size = H5Tget_size(type);
+		H5Tclose(type);
+		for (int i = 1; i < rank; ++i)
+			row_size *= dims[i];
+
+		return std::max<hsize_t>(1, CHUNK_BYTES / row_size);
+	}
+
+	void HDF5File::write_rows(const hid_t dset, const hid_t mem_type, const void *data, const hsize_t first_row, const hsize_t n_rows)
+	{
+		if (n_rows == 0)
+			return;
+
+		const hid_t file_space = H5Dget_space(dset);
+		hsize_t start[H5S_MAX_RANK] = {0};
+		hsize_t count[H5S_MAX_RANK];
+		const int rank = H5Sget_simple_extent_dims(file_space, count, nullptr);
+		start[0] = this->first_row(dset) + first_row;
+		count[0] = n_rows;
+		H5Sselect_hyperslab(file_space, H5S_SELECT_SET, start, nullptr, count, nullptr);
+
+		hsize_t size = 1;
+		for (int i = 0; i < rank; ++i)
+			size *= count[i];
+		const hid_t mem_space = H5Screate_simple(1, &size, nullptr);
+
+		const herr_t status = H5Dwrite(dset, mem_type, mem_space, file_space, H5P_DEFAULT, data);
+		H5Sclose(mem_space);
+		H5Sclose(file_space);
+		check(status, "unable to write rows");
+	}
+
+	void HDF5File::write_columns(const hid_t dset, const hid_t mem_type, const void *data, const hsize_t ld, const hsize_t first_row, const hsize_t n_rows, const hsize_t first_col, const hsize_t n_cols, const hsize_t row_size)
+	{
+		if (n_rows == 0)
+			return;
+
+		const size_t entry_size = H5Tget_size(mem_type);
+		// Appended rows start after the existing entries of the dataset
+		const hsize_t base = this->first_row(dset);
+		const hid_t file_space = H5Dget_space(dset);
+		const bool flat = H5Sget_simple_extent_ndims(file_space) == 1;
+		const hid_t mem_space = H5Screate_simple(1, &n_rows, nullptr);
+
+		herr_t status = 0;
+		for (hsize_t j = 0; j < n_cols && status >= 0; ++j)
+		{
+			if (flat)
+			{
+				const hsize_t start = base + first_row * row_size + first_col + j;
+				H5Sselect_hyperslab(file_space, H5S_SELECT_SET, &start, &row_size, &n_rows, nullptr);
+			}
+			else
+			{
+				const hsize_t start[2] = {base + first_row, first_col + j};
+				const hsize_t count[2] = {n_rows, 1};
+				H5Sselect_hyperslab(file_space, H5S_SELECT_SET, start, nullptr, count, nullptr);
+			}
+
+			const char *column = static_cast<const char *>(data) + j * ld * entry_size;
+			status = H5Dwrite(dset, mem_type, mem_space, file_space, H5P_DEFAULT, column);
+		}
+
+		H5Sclose(mem_space);
+		H5Sclose(file_space);
+		check(status, "unable to write columns");
+	}
+
+	void HDF5File::write_dataset(const std::string &path, const hid_t type, const void *data, const std::vector<hsize_t> &dims)
+	{
+		const hid_t dset = create_dataset(path, type, dims);
+		write_rows(dset, type, data, 0, dims[0]);
+		release_dataset(dset);
+	}
+
+	void HDF5File::create_soft_link(const std::string &target, const std::string &path)
+	{
+		check(H5Lcreate_soft(target.c_str(), file_, path.c_str(), lcpl_, H5P_DEFAULT), "unable to create link " + path);
+	}
+
+	bool HDF5File::exists(const std::string &path) const
+	{
+		// Every level has to be checked, H5Lexists fails on missing intermediate groups
+		for (size_t end = path.find('/', 1); true; end = path.find('/', end + 1))
+		{
+			const std::string prefix = path.substr(0, end);
+			if (!prefix.empty() && prefix != "/" && H5Lexists(file_, prefix.c_str(), H5P_DEFAULT) <= 0)
+				return false;
+			if (end == std::string::npos)
+				return true;
+		}
+	}
+
+	std::vector<std::string> HDF5File::list_group(const std::string &path) const
+	{
+		std::vector<std::string> names;
+		if (!exists(path))
+			return names;
+
+		H5Literate_by_name(
+			file_, path.c_str(), H5_INDEX_NAME, H5_ITER_INC, nullptr, [](hid_t, const char *name, const H5L_info_t *, void *data) -> herr_t {
+				static_cast<std::vector<std::string> *>(data)->push_back(name);
+				return 0;
+			},
+			&names, H5P_DEFAULT);
+		return names;
+	}
+
+	hsize_t HDF5File::dataset_rows(const std::string &path) const
+	{
+		const auto it = datasets_.find(path);
+		if (it != datasets_.end())
+			return it->second.dims[0];
+		if (!exists(path))
+			return 0;
+
+		const hid_t dset = H5Dopen2(file_, path.c_str(), H5P_DEFAULT);
+		const hid_t space = H5Dget_space(dset);
+		hsize_t dims[H5S_MAX_RANK] = {0};
+		H5Sget_simple_extent_dims(space, dims, nullptr);
+		H5Sclose(space);
+		H5Dclose(dset);
+		return dims[0];
+	}
+
+	void HDF5File::remove_unused_datasets()
+	{
+		for (auto it = datasets_.begin(); it != datasets_.end();)
+		{
+			if (it->second.used)
+			{
+				it->second.used = false;
+				++it;
+				continue;
+			}
+
+			H5Dclose(it->second.id);
+			H5Ldelete(file_, it->first.c_str(), H5P_DEFAULT);
+			it = datasets_.erase(it);
+		}
+	}
+
+	void HDF5File::write_attribute(const std::string &obj, const std::string &name, const hid_t type, const void *data, const size_t size)
+	{
+		if (H5Aexists_by_name(file_, obj.c_str(), name.c_str(), H5P_DEFAULT) > 0)
+			H5Adelete_by_name(file_, obj.c_str(), name.c_str(), H5P_DEFAULT);
+
+		const hsize_t dims = size;
+		const hid_t space = H5Screate_simple(1, &dims, nullptr);
+		const hid_t attr = H5Acreate_by_name(file_, obj.c_str(), name.c_str(), type, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+		H5Sclose(space);
+
+		if (attr < 0)
+			throw std::runtime_error("HDF5 error: unable to create attribute " + obj + "/" + name);
+
+		const herr_t status = H5Awrite(attr, type, data);
+		H5Aclose(attr);
+		check(status, "unable to write attribute " + obj + "/" + name);
+	}
+
+	void HDF5File::write_attribute(const std::string &obj, const std::string &name, const std::string &value)
+	{
+		const hid_t type = H5Tcopy(H5T_C_S1);
+		H5Tset_size(type, value.size());
+		H5Tset_strpad(type, H5T_STR_NULLPAD);
+
+		if (H5Aexists_by_name(file_, obj.c_str(), name.c_str(), H5P_DEFAULT) > 0)
+			H5Adelete_by_name(file_, obj.c_str(), name.c_str(), H5P_DEFAULT);
+
+		const hid_t space = H5Screate(H5S_SCALAR);
+		const hid_t attr = H5Acreate_by_name(file_, obj.c_str(), name.c_str(), type, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+		H5Sclose(space);
+
+		herr_t status = -1;
+		if (attr >= 0)
+		{
+			status = H5Awrite(attr, type, value.data());
+			H5Aclose(attr);
+		}
+		H5Tclose(type);
+
+		check(status, "unable to write attribute " + obj + "/" + name);
+	}
+
+	void HDF5File::flush()
+	{
+		if (is_open())
+			check(H5Fflush(file_, H5F_SCOPE_LOCAL), "unable to flush");
+	}
+
+	bool HDF5File::image(std::vector<char> &buffer) const
+	{
+		if (!is_open())
+			return false;
+
+		H5Fflush(file_, H5F_SCOPE_LOCAL);
+		const ssize_t size = H5Fget_file_image(file_, nullptr, 0);
+		if (size < 0)
+			return false;
+
+		buffer.resize(size);
+		return H5Fget_file_image(file_, buffer.data(), buffer.size()) == size;
+	}
+
+	bool HDF5File::write_image(Sink &sink)
+	{
+		if (!is_open())
+			return false;
+
+		if (!core_image_.tracked)
+		{
+			std::vector<char> buffer;
+			if (!image(buffer))
+				return false;
+			close();
+
+			sink.write(buffer.data(), buffer.size());
+			sink.flush();
+			return sink.good();
+		}
+
+		// Closing the file writes the cached metadata into the buffer of the core driver, which is then kept and written
+		// as is: H5Fget_file_image gives its size without copying it
+		flush();
+		const ssize_t size = H5Fget_file_image(file_, nullptr, 0);
+		core_image_.keep = true;
+		const bool closed = close();
+		core_image_.keep = false;
+
+		const bool ok = closed && size >= 0 && size_t(size) <= core_image_.size;
+		if (ok)
+		{
+			sink.write(static_cast<const char *>(core_image_.buffer), size);
+			sink.flush();
+		}
+		std::free(core_image_.buffer);
+		core_image_.buffer = nullptr;
+		core_image_.size = 0;
+
+		return ok && sink.good();
+	}
+} // namespace paraviewo
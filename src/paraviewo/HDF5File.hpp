@@ -0,0 +1,243 @@
+#pragma once
+
+#include "DeltaFilter.hpp"
+#include "Sink.hpp"
+#include "WriteStats.hpp"
+#include "Workspace.hpp"
+
+#include <hdf5.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace paraviewo
+{
+	template <typename T>
+	inline hid_t hdf5_native_type();
+
+	template <>
+	inline hid_t hdf5_native_type<double>() { return H5T_NATIVE_DOUBLE; }
+	template <>
+	inline hid_t hdf5_native_type<float>() { return H5T_NATIVE_FLOAT; }
+	template <>
+	inline hid_t hdf5_native_type<int>() { return H5T_NATIVE_INT; }
+	template <>
+	inline hid_t hdf5_native_type<int64_t>() { return H5T_NATIVE_INT64; }
+	template <>
+	inline hid_t hdf5_native_type<uint8_t>() { return H5T_NATIVE_UINT8; }
+
+	/// Preconditioning of the monotonic index arrays (connectivity, offsets) before shuffle + deflate
+	enum class IndexPreconditioning
+	{
+		None,
+		/// HDF5 scale-offset filter: every chunk stores its minimum and the remaining bits only. Built into HDF5,
+		/// the files are readable everywhere. The packed bits defeat deflate, very regular meshes compress better without it.
+		ScaleOffset,
+		/// Delta coding (custom filter DELTA_FILTER_ID), offsets become constant and connectivity small. Readers need the
+		/// filter: call register_delta_filter before opening the file, or load the plugin paraviewo_delta_filter
+		/// (HDF5_PLUGIN_PATH).
+		Delta
+	};
+
+	/// Makes the delta filter available to this process, can be called several times. Returns false if another filter
+	/// is registered with DELTA_FILTER_ID: the index arrays are then written without delta coding.
+	bool register_delta_filter();
+
+	/// HDF5 is not thread safe (in most builds): threads writing HDF5 files concurrently must hold this mutex
+	std::mutex &hdf5_mutex();
+
+	/// Creation settings shared by the VTKHDF writers, see HDF5File::create_vtkhdf
+	struct HDF5FileSettings
+	{
+		/// Assemble the file in memory and write it with one sequential write when closed
+		bool core_staging = false;
+		size_t page_size = 0;
+		bool latest_format = false;
+		int compression_level = 5;
+		IndexPreconditioning index_preconditioning = IndexPreconditioning::None;
+	};
+
+	/// Thin RAII wrapper around an HDF5 file handle, errors are reported with std::runtime_error
+	class HDF5File
+	{
+	public:
+		HDF5File();
+		~HDF5File();
+
+		HDF5File(const HDF5File &) = delete;
+		void operator=(const HDF5File &) = delete;
+
+		/// Creates (or truncates) a file on disk
+		bool create(const std::string &path);
+		/// Creates a file that lives in memory (HDF5 core driver), its content is retrieved with image().
+		/// With backing_store the whole image is written to name in one sequential write when the file is closed.
+		bool create_in_memory(const std::string &name, const bool backing_store = false);
+		/// Creates a file with the settings of a writer and its VTKHDF root group, in_memory keeps it in memory
+		/// whatever the staging (e.g., to be written to a sink with write_image)
+		bool create_vtkhdf(const std::string &path, const bool in_memory, const HDF5FileSettings &settings, Workspace *workspace);
+		/// Returns false if the file could not be written (e.g., the final flush of a staged file failed)
+		bool close();
+
+		inline bool is_open() const { return file_ >= 0; }
+		inline hid_t id() const { return file_; }
+
+		/// Deflate level used for large datasets, 0 disables compression
+		inline void set_compression_level(const int level) { compression_level_ = level; }
+		inline int compression_level() const { return compression_level_; }
+
+		/// Adaptive compression: the level of each field is chosen with choose_compression_level, the highest ratio
+		/// compressing at target_mb_per_s at least. 0 disables it (compression_level is used). Only the writers of the
+		/// fields (HDF5VTKDataNode) query it, the other datasets always use compression_level.
+		inline void set_adaptive_compression(const double target_mb_per_s) { adaptive_target_ = target_mb_per_s; }
+		inline bool adaptive_compression() const { return adaptive_target_ > 0 && compression_level_ > 0; }
+		/// Compresses the sample (n values of type) at a few levels in a scratch in-memory file, with the same filters
+		/// as the datasets, and returns the level with the best ratio meeting the throughput target (0 when compressing
+		/// does not pay off). The measurements are stored in choice.
+		int choose_compression_level(const hid_t type, const void *sample, const hsize_t n, ArrayCompression &choice) const;
+
+		/// Creation settings, they only apply to files created afterwards
+		/// Latest file format: compact metadata, requires a recent HDF5 to read the file
+		inline void set_latest_format(const bool latest) { latest_format_ = latest; }
+		/// Paged file space aggregation with the given page size, 0 disables it
+		inline void set_page_size(const size_t page_size) { page_size_ = page_size; }
+		/// Growth step of in-memory files
+		inline void set_memory_increment(const size_t increment) { memory_increment_ = increment; }
+
+		/// Scratch memory of the block writes (e.g., the workspace of the writer), nullptr uses one owned by the file
+		inline void set_workspace(Workspace *workspace) { workspace_ = workspace ? workspace : &own_workspace_; }
+		inline Workspace &workspace() const { return *workspace_; }
+
+		/// Filters of the index datasets (create_index_dataset), only used with compression
+		inline void set_index_preconditioning(const IndexPreconditioning preconditioning) { index_preconditioning_ = preconditioning; }
+
+		/// Keeps the dataset handles open: writing again to the same path overwrites the dataset in place,
+		/// resizing it if the shape changed. Datasets are then always chunked (hence resizable).
+		inline void set_reuse_datasets(const bool reuse) { reuse_datasets_ = reuse; }
+		/// Unlinks the reused datasets that have not been written since the last call
+		void remove_unused_datasets();
+		/// Time series: writing again to the same path appends the rows at the end of the dataset instead of
+		/// overwriting it (the other dimensions must not change). Implies set_reuse_datasets(true).
+		inline void set_append(const bool append)
+		{
+			append_ = append;
+			reuse_datasets_ = reuse_datasets_ || append;
+		}
+
+		void create_group(const std::string &path);
+		/// Soft link path pointing to target (e.g., the assembly of a collection), intermediate groups are created
+		void create_soft_link(const std::string &target, const std::string &path);
+		bool exists(const std::string &path) const;
+		/// Names of the links in the group at path, empty if it does not exist
+		std::vector<std::string> list_group(const std::string &path) const;
+		/// Size of the first dimension of the dataset at path, 0 if it does not exist
+		hsize_t dataset_rows(const std::string &path) const;
+
+		/// Writes a row-major array of shape dims
+		template <typename T>
+		void write_dataset(const std::string &path, const T *data, const std::vector<hsize_t> &dims)
+		{
+			write_dataset(path, hdf5_native_type<T>(), data, dims);
+		}
+		void write_dataset(const std::string &path, const hid_t type, const void *data, const std::vector<hsize_t> &dims);
+
+		/// Returns a dataset of the given type and shape (created, or reused), it must be given back with release_dataset.
+		/// By default large datasets are chunked along the first dimension, chunk forces the chunk shape (e.g., N-D blocks
+		/// of a regular grid so that sub-volumes can be read without decompressing whole slabs).
+		hid_t create_dataset(const std::string &path, const hid_t type, const std::vector<hsize_t> &dims, const std::vector<hsize_t> &chunk = {});
+		/// Same with a specific deflate level (0 stores the dataset uncompressed)
+		hid_t create_dataset(const std::string &path, const hid_t type, const std::vector<hsize_t> &dims, const std::vector<hsize_t> &chunk, const int compression_level);
+		/// Int64 index array (connectivity, offsets), stored with the index preconditioning
+		hid_t create_index_dataset(const std::string &path, const hsize_t size);
+		void write_index_dataset(const std::string &path, const int64_t *data, const hsize_t size);
+		void release_dataset(const hid_t dset);
+
+		/// Number of rows to write at once in block writes, matches the chunking of dset
+		hsize_t block_rows(const hid_t dset) const;
+		/// Writes the row-major block data to the rows [first_row, first_row + n_rows) of dset (1D or 2D)
+		void write_rows(const hid_t dset, const hid_t mem_type, const void *data, const hsize_t first_row, const hsize_t n_rows);
+		/// Writes a block of a column-major matrix (leading dimension ld) directly to a row-major dataset, one hyperslab per column.
+		/// The block goes to rows [first_row, first_row + n_rows) and columns [first_col, first_col + n_cols), where a row has
+		/// row_size entries: dset is either 2D (n x row_size) or a flattened 1D array.
+		void write_columns(const hid_t dset, const hid_t mem_type, const void *data, const hsize_t ld, const hsize_t first_row, const hsize_t n_rows, const hsize_t first_col, const hsize_t n_cols, const hsize_t row_size);
+
+		/// Writes rows x cols entries block by block through a bounded buffer, fill(begin, end, buffer) produces the rows [begin, end) in row-major order
+		template <typename T, typename Fill>
+		void write_blocks(const hid_t dset, const hsize_t rows, const hsize_t cols, const Fill &fill)
+		{
+			const hsize_t block = block_rows(dset);
+			Workspace::Scope scope(*workspace_);
+			T *buffer = workspace_->allocate<T>(std::min(block, rows) * cols);
+			for (hsize_t begin = 0; begin < rows; begin += block)
+			{
+				const hsize_t end = std::min(rows, begin + block);
+				fill(begin, end, buffer);
+				write_rows(dset, hdf5_native_type<T>(), buffer, begin, end - begin);
+			}
+		}
+
+		template <typename T>
+		void write_attribute(const std::string &obj, const std::string &name, const T *data, const size_t size)
+		{
+			write_attribute(obj, name, hdf5_native_type<T>(), data, size);
+		}
+		void write_attribute(const std::string &obj, const std::string &name, const hid_t type, const void *data, const size_t size);
+		/// Fixed length, null padded ascii string, as expected by VTK
+		void write_attribute(const std::string &obj, const std::string &name, const std::string &value);
+
+		void flush();
+
+		/// Copies the current content of the file, mostly useful for in-memory files
+		bool image(std::vector<char> &buffer) const;
+		/// Closes the file and writes its image to the sink. The image of a file created with create_in_memory (without
+		/// backing store) is written in place from the memory of the core driver, without a copy.
+		bool write_image(Sink &sink);
+
+	private:
+		struct CachedDataset
+		{
+			hid_t id;
+			std::vector<hsize_t> dims;
+			bool used;
+		};
+
+		/// Memory of the core driver, tracked through the file image callbacks so that write_image can use it in place
+		struct CoreImage
+		{
+			void *buffer = nullptr;
+			size_t size = 0;
+			bool tracked = false;
+			/// Closing the file hands the buffer over to write_image instead of freeing it
+			bool keep = false;
+		};
+
+		hid_t file_;
+		hid_t lcpl_;
+		CoreImage core_image_;
+		int compression_level_;
+		double adaptive_target_;
+		IndexPreconditioning index_preconditioning_;
+
+		bool latest_format_;
+		size_t page_size_;
+		size_t memory_increment_;
+
+		bool reuse_datasets_;
+		std::map<std::string, CachedDataset> datasets_;
+
+		Workspace own_workspace_;
+		Workspace *workspace_;
+
+		bool append_;
+		/// Row where the writes to an appended dataset start
+		std::map<hid_t, hsize_t> first_rows_;
+		hsize_t first_row(const hid_t dset) const;
+
+		bool create(const std::string &path, const hid_t fapl);
+		hid_t create_dataset(const std::string &path, const hid_t type, const std::vector<hsize_t> &dims, const std::vector<hsize_t> &chunk, const int level, const bool index);
+		hid_t dataset_creation_plist(const hid_t type, const std::vector<hsize_t> &dims, const std::vector<hsize_t> &chunk, const int level, const bool index) const;
+	};
+} // namespace paraviewo
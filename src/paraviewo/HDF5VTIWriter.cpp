@@ -0,0 +1,163 @@
+#include "HDF5VTIWriter.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace paraviewo
+{
+
+	HDF5VTIWriter::HDF5VTIWriter()
+		: chunk_dims_(32, 32, 32), direction_(Eigen::Matrix3d::Identity()), adaptive_target_(0), time_budget_(0), zero_copy_(false), n_point_data_(0), n_cell_data_(0)
+	{
+	}
+
+	void HDF5VTIWriter::clear()
+	{
+		n_point_data_ = 0;
+		n_cell_data_ = 0;
+	}
+
+	HDF5VTKDataNode<double> &HDF5VTIWriter::next_node(const bool is_point)
+	{
+		std::vector<HDF5VTKDataNode<double>> &nodes = is_point ? point_data_ : cell_data_;
+		size_t &n_nodes = is_point ? n_point_data_ : n_cell_data_;
+		if (n_nodes == nodes.size())
+			nodes.push_back(HDF5VTKDataNode<double>(is_point));
+		return nodes[n_nodes++];
+	}
+
+	void HDF5VTIWriter::add_scalar_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		HDF5VTKDataNode<double> &node = next_node(true);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
+	}
+
+	void HDF5VTIWriter::add_vector_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		HDF5VTKDataNode<double> &node = next_node(true);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
+	}
+
+	void HDF5VTIWriter::add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		HDF5VTKDataNode<double> &node = next_node(false);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
+	}
+
+	void HDF5VTIWriter::add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		HDF5VTKDataNode<double> &node = next_node(false);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
+	}
+
+	void HDF5VTIWriter::add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point)
+	{
+		HDF5VTKDataNode<double> &node = next_node(is_point);
+		node.initialize(name, n_rows, n_components, fill, n_threads_);
+		node.set_precision(field_precision(name));
+	}
+
+	bool HDF5VTIWriter::fields_match_grid(const Eigen::Vector3i &n_points) const
+	{
+		if (n_points.minCoeff() < 1)
+			return false;
+
+		// The fields are written as N-D arrays of the grid shape, a different size would be read out of bounds
+		const int64_t n_grid_points = int64_t(n_points(0)) * n_points(1) * n_points(2);
+		const int64_t n_grid_cells = int64_t(std::max(1, n_points(0) - 1)) * std::max(1, n_points(1) - 1) * std::max(1, n_points(2) - 1);
+		for (size_t i = 0; i < n_point_data_; ++i)
+		{
+			if (point_data_[i].n_rows() != n_grid_points)
+				return false;
+		}
+		for (size_t i = 0; i < n_cell_data_; ++i)
+		{
+			if (cell_data_[i].n_rows() != n_grid_cells)
+				return false;
+		}
+		return true;
+	}
+
+	void HDF5VTIWriter::write(const Eigen::Vector3d &origin, const Eigen::Vector3d &spacing, const Eigen::Vector3i &n_points, HDF5File &file)
+	{
+		begin_write();
+		const std::array<int64_t, 2> version = {{1, 0}};
+		file.write_attribute("VTKHDF", "Version", version.data(), version.size());
+		file.write_attribute("VTKHDF", "Type", "ImageData");
+
+		std::array<int64_t, 6> extent;
+		for (int d = 0; d < 3; ++d)
+		{
+			extent[2 * d] = 0;
+			extent[2 * d + 1] = std::max(0, n_points(d) - 1);
+		}
+		file.write_attribute("VTKHDF", "WholeExtent", extent.data(), extent.size());
+		file.write_attribute("VTKHDF", "Origin", origin.data(), 3);
+		file.write_attribute("VTKHDF", "Spacing", spacing.data(), 3);
+
+		// Row-major, as read by VTK
+		const Eigen::Matrix3d direction = direction_.transpose();
+		file.write_attribute("VTKHDF", "Direction", direction.data(), 9);
+
+		// z slowest, flat axes of 2D grids still have one cell layer
+		const std::vector<hsize_t> point_grid = {hsize_t(n_points(2)), hsize_t(n_points(1)), hsize_t(n_points(0))};
+		const std::vector<hsize_t> cell_grid = {hsize_t(std::max(1, n_points(2) - 1)), hsize_t(std::max(1, n_points(1) - 1)), hsize_t(std::max(1, n_points(0) - 1))};
+		const std::vector<hsize_t> chunk = {hsize_t(chunk_dims_(2)), hsize_t(chunk_dims_(1)), hsize_t(chunk_dims_(0))};
+
+		int64_t raw_bytes = 0;
+		for (size_t i = 0; i < n_point_data_; ++i)
+			raw_bytes += point_data_[i].raw_bytes();
+		for (size_t i = 0; i < n_cell_data_; ++i)
+			raw_bytes += cell_data_[i].raw_bytes();
+		file.set_adaptive_compression(adaptive_compression_target(adaptive_target_, time_budget_, raw_bytes));
+
+		file.create_group("VTKHDF/PointData");
+		for (size_t i = 0; i < n_point_data_; ++i)
+		{
+			point_data_[i].set_grid(point_grid, chunk);
+			point_data_[i].write(file, &stats_);
+		}
+
+		file.create_group("VTKHDF/CellData");
+		for (size_t i = 0; i < n_cell_data_; ++i)
+		{
+			cell_data_[i].set_grid(cell_grid, chunk);
+			cell_data_[i].write(file, &stats_);
+		}
+		end_write();
+	}
+
+	bool HDF5VTIWriter::write_mesh(const std::string &path, const Eigen::Vector3d &origin, const Eigen::Vector3d &spacing, const Eigen::Vector3i &n_points)
+	{
+		if (!fields_match_grid(n_points))
+			return false;
+
+		HDF5File file;
+		if (!file.create_vtkhdf(path, false, file_settings_, &workspace()))
+			return false;
+
+		write(origin, spacing, n_points, file);
+
+		clear();
+		return file.close();
+	}
+
+	bool HDF5VTIWriter::write_mesh(Sink &sink, const Eigen::Vector3d &origin, const Eigen::Vector3d &spacing, const Eigen::Vector3i &n_points)
+	{
+		if (!fields_match_grid(n_points))
+			return false;
+
+		HDF5File file;
+		if (!file.create_vtkhdf("paraviewo.hdf", true, file_settings_, &workspace()))
+			return false;
+
+		write(origin, spacing, n_points, file);
+
+		clear();
+		return file.write_image(sink);
+	}
+} // namespace paraviewo
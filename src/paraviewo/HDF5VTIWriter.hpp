@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ParaviewWriter.hpp"
+#include "HDF5VTUWriter.hpp"
+#include "HDF5File.hpp"
+
+#include <Eigen/Dense>
+
+#include <string>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Uniform grids in the VTKHDF ImageData layout: the geometry is only stored as attributes (WholeExtent, Origin,
+	/// Spacing, Direction) and fields are N-D arrays (nz x ny x nx [x components]) chunked in blocks, so that
+	/// a sub-volume can be read back without decompressing the whole field.
+	/// Point fields are ordered with x varying fastest, then y, then z.
+	class HDF5VTIWriter : public FieldWriter
+	{
+	public:
+		HDF5VTIWriter();
+
+		/// n_points(2) == 1 for 2D grids. Returns false, without creating the file, if a field does not match the grid
+		/// (n_points.prod() points, max(1, n - 1) cells along each axis).
+		bool write_mesh(const std::string &path, const Eigen::Vector3d &origin, const Eigen::Vector3d &spacing, const Eigen::Vector3i &n_points);
+		/// The file is assembled in memory with the HDF5 core driver, then its image is written to the sink
+		bool write_mesh(Sink &sink, const Eigen::Vector3d &origin, const Eigen::Vector3d &spacing, const Eigen::Vector3i &n_points);
+
+		void clear() override;
+		bool uses_hdf5() const override { return true; }
+
+		/// Chunk shape of the fields along x, y, z (the components are never split)
+		inline void set_chunk_dims(const Eigen::Vector3i &chunk_dims) { chunk_dims_ = chunk_dims; }
+		/// Axes of the grid (columns), identity by default
+		inline void set_direction(const Eigen::Matrix3d &direction) { direction_ = direction; }
+
+		/// Same as HDF5VTUWriter
+		inline void set_core_staging(const bool staging) { file_settings_.core_staging = staging; }
+		inline void set_page_size(const size_t page_size) { file_settings_.page_size = page_size; }
+		inline void set_latest_format(const bool latest) { file_settings_.latest_format = latest; }
+		inline void set_zero_copy(const bool zero_copy) { zero_copy_ = zero_copy; }
+		inline void set_adaptive_compression(const double target_mb_per_s) { adaptive_target_ = target_mb_per_s; }
+		inline void set_compression_time_budget(const double seconds) { time_budget_ = seconds; }
+
+	protected:
+		void add_scalar_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point) override;
+
+	private:
+		Eigen::Vector3i chunk_dims_;
+		Eigen::Matrix3d direction_;
+
+		HDF5FileSettings file_settings_;
+		double adaptive_target_;
+		double time_budget_;
+		bool zero_copy_;
+
+		/// Only the first n_point_data_ (n_cell_data_) nodes are in use, clear keeps the nodes to reuse their storage
+		std::vector<HDF5VTKDataNode<double>> point_data_;
+		size_t n_point_data_;
+		std::vector<HDF5VTKDataNode<double>> cell_data_;
+		size_t n_cell_data_;
+
+		HDF5VTKDataNode<double> &next_node(const bool is_point);
+
+		bool fields_match_grid(const Eigen::Vector3i &n_points) const;
+		void write(const Eigen::Vector3d &origin, const Eigen::Vector3d &spacing, const Eigen::Vector3i &n_points, HDF5File &file);
+	};
+} // namespace paraviewo
@@ -0,0 +1,211 @@
+#include "HDF5VTPWriter.hpp"
+
+#include <array>
+
+namespace paraviewo
+{
+	namespace
+	{
+		std::string topology_group(const CellType ctype)
+		{
+			switch (ctype)
+			{
+			case CellType::Vertex:
+				return "Vertices";
+			case CellType::Line:
+				return "Lines";
+			case CellType::Triangle:
+			case CellType::Quadrilateral:
+			case CellType::Polygon:
+				return "Polygons";
+			default:
+				return "";
+			}
+		}
+	} // namespace
+
+	HDF5VTPWriter::HDF5VTPWriter()
+		: adaptive_target_(0), time_budget_(0), zero_copy_(false), n_point_data_(0), n_cell_data_(0)
+	{
+	}
+
+	void HDF5VTPWriter::clear()
+	{
+		n_point_data_ = 0;
+		n_cell_data_ = 0;
+	}
+
+	HDF5VTKDataNode<double> &HDF5VTPWriter::next_node(const bool is_point)
+	{
+		std::vector<HDF5VTKDataNode<double>> &nodes = is_point ? point_data_ : cell_data_;
+		size_t &n_nodes = is_point ? n_point_data_ : n_cell_data_;
+		if (n_nodes == nodes.size())
+			nodes.push_back(HDF5VTKDataNode<double>(is_point));
+		return nodes[n_nodes++];
+	}
+
+	void HDF5VTPWriter::add_scalar_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		HDF5VTKDataNode<double> &node = next_node(true);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
+	}
+
+	void HDF5VTPWriter::add_vector_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		HDF5VTKDataNode<double> &node = next_node(true);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
+	}
+
+	void HDF5VTPWriter::add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		HDF5VTKDataNode<double> &node = next_node(false);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
+	}
+
+	void HDF5VTPWriter::add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		HDF5VTKDataNode<double> &node = next_node(false);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
+	}
+
+	void HDF5VTPWriter::add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point)
+	{
+		HDF5VTKDataNode<double> &node = next_node(is_point);
+		node.initialize(name, n_rows, n_components, fill, n_threads_);
+		node.set_precision(field_precision(name));
+	}
+
+	void HDF5VTPWriter::write_topology(const std::string &grp, const hsize_t n_cells, const hsize_t n_cell_vertices, const Eigen::MatrixXi *cells, HDF5File &file)
+	{
+		const std::string path = "/VTKHDF/" + grp;
+		file.create_group(path);
+
+		const int64_t n = n_cells;
+		file.write_dataset(path + "/NumberOfCells", &n, {1});
+		const int64_t n_connectivity = n_cells * n_cell_vertices;
+		file.write_dataset(path + "/NumberOfConnectivityIds", &n_connectivity, {1});
+
+		hid_t dset = file.create_index_dataset(path + "/Connectivity", n_cells * n_cell_vertices);
+		if (cells)
+		{
+			// Strided writes from the column-major cells
+			const hsize_t block = std::max<hsize_t>(1, file.block_rows(dset) / std::max<hsize_t>(1, n_cell_vertices));
+			for (hsize_t begin = 0; begin < n_cells; begin += block)
+			{
+				const hsize_t n_block = std::min(block, n_cells - begin);
+				file.write_columns(dset, H5T_NATIVE_INT, cells->data() + begin, n_cells, begin, n_block, 0, n_cell_vertices, n_cell_vertices);
+			}
+		}
+		else
+		{
+			file.write_blocks<int64_t>(dset, n_cells, 1, [](const hsize_t begin, const hsize_t end, int64_t *out) {
+				for (hsize_t i = begin; i < end; ++i)
+					*out++ = i;
+			});
+		}
+		file.release_dataset(dset);
+
+		dset = file.create_index_dataset(path + "/Offsets", n_cells + 1);
+		file.write_blocks<int64_t>(dset, n_cells + 1, 1, [&](const hsize_t begin, const hsize_t end, int64_t *out) {
+			for (hsize_t i = begin; i < end; ++i)
+				*out++ = i * n_cell_vertices;
+		});
+		file.release_dataset(dset);
+	}
+
+	void HDF5VTPWriter::write(const Eigen::MatrixXd &points, const std::string &grp, const hsize_t n_cells, const hsize_t n_cell_vertices, const Eigen::MatrixXi *cells, HDF5File &file)
+	{
+		begin_write();
+		const std::array<int64_t, 2> version = {{2, 0}};
+		file.write_attribute("VTKHDF", "Version", version.data(), version.size());
+		file.write_attribute("VTKHDF", "Type", "PolyData");
+
+		const int64_t n_points = points.rows();
+		file.write_dataset("/VTKHDF/NumberOfPoints", &n_points, {1});
+		write_hdf5_points(points, file);
+
+		// The reader expects the four topologies
+		for (const std::string g : {"Vertices", "Lines", "Polygons", "Strips"})
+		{
+			if (g == grp)
+				write_topology(g, n_cells, n_cell_vertices, cells, file);
+			else
+				write_topology(g, 0, 0, nullptr, file);
+		}
+
+		int64_t raw_bytes = 0;
+		for (size_t i = 0; i < n_point_data_; ++i)
+			raw_bytes += point_data_[i].raw_bytes();
+		for (size_t i = 0; i < n_cell_data_; ++i)
+			raw_bytes += cell_data_[i].raw_bytes();
+		file.set_adaptive_compression(adaptive_compression_target(adaptive_target_, time_budget_, raw_bytes));
+
+		for (size_t i = 0; i < n_point_data_; ++i)
+			point_data_[i].write(file, &stats_);
+		for (size_t i = 0; i < n_cell_data_; ++i)
+			cell_data_[i].write(file, &stats_);
+		end_write();
+	}
+
+	bool HDF5VTPWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		const std::string grp = topology_group(ctype);
+		assert(!grp.empty());
+		if (grp.empty())
+			return false;
+
+		HDF5File file;
+		if (!file.create_vtkhdf(path, false, file_settings_, &workspace()))
+			return false;
+
+		write(points, grp, cells.rows(), cells.cols(), &cells, file);
+
+		clear();
+		return file.close();
+	}
+
+	bool HDF5VTPWriter::write_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		const std::string grp = topology_group(ctype);
+		assert(!grp.empty());
+		if (grp.empty())
+			return false;
+
+		HDF5File file;
+		if (!file.create_vtkhdf("paraviewo.hdf", true, file_settings_, &workspace()))
+			return false;
+
+		write(points, grp, cells.rows(), cells.cols(), &cells, file);
+
+		clear();
+		return file.write_image(sink);
+	}
+
+	bool HDF5VTPWriter::write_points(const std::string &path, const Eigen::MatrixXd &points, const bool with_vertices)
+	{
+		HDF5File file;
+		if (!file.create_vtkhdf(path, false, file_settings_, &workspace()))
+			return false;
+
+		write(points, with_vertices ? "Vertices" : "", points.rows(), 1, nullptr, file);
+
+		clear();
+		return file.close();
+	}
+
+	bool HDF5VTPWriter::write_points(Sink &sink, const Eigen::MatrixXd &points, const bool with_vertices)
+	{
+		HDF5File file;
+		if (!file.create_vtkhdf("paraviewo.hdf", true, file_settings_, &workspace()))
+			return false;
+
+		write(points, with_vertices ? "Vertices" : "", points.rows(), 1, nullptr, file);
+
+		clear();
+		return file.write_image(sink);
+	}
+} // namespace paraviewo
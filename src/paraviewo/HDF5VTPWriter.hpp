@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ParaviewWriter.hpp"
+#include "HDF5VTUWriter.hpp"
+#include "HDF5File.hpp"
+
+#include <Eigen/Dense>
+
+#include <string>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Surfaces, curves and point clouds in the VTKHDF PolyData layout (Vertices, Lines, Polygons and Strips groups)
+	class HDF5VTPWriter : public FieldWriter
+	{
+	public:
+		HDF5VTPWriter();
+
+		/// ctype is Vertex, Line, Triangle, Quadrilateral or Polygon
+		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype);
+		bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype);
+
+		/// Particles: one vertex per point, the trivial Vertices topology is generated block by block (or omitted
+		/// without with_vertices), so the cost is only the points and the fields
+		bool write_points(const std::string &path, const Eigen::MatrixXd &points, const bool with_vertices = true);
+		bool write_points(Sink &sink, const Eigen::MatrixXd &points, const bool with_vertices = true);
+
+		void clear() override;
+		bool uses_hdf5() const override { return true; }
+
+		/// Same as HDF5VTUWriter
+		inline void set_core_staging(const bool staging) { file_settings_.core_staging = staging; }
+		inline void set_page_size(const size_t page_size) { file_settings_.page_size = page_size; }
+		inline void set_latest_format(const bool latest) { file_settings_.latest_format = latest; }
+		inline void set_index_preconditioning(const IndexPreconditioning preconditioning) { file_settings_.index_preconditioning = preconditioning; }
+		inline void set_zero_copy(const bool zero_copy) { zero_copy_ = zero_copy; }
+		inline void set_adaptive_compression(const double target_mb_per_s) { adaptive_target_ = target_mb_per_s; }
+		inline void set_compression_time_budget(const double seconds) { time_budget_ = seconds; }
+
+	protected:
+		void add_scalar_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point) override;
+
+	private:
+		HDF5FileSettings file_settings_;
+		double adaptive_target_;
+		double time_budget_;
+		bool zero_copy_;
+
+		/// Only the first n_point_data_ (n_cell_data_) nodes are in use, clear keeps the nodes to reuse their storage
+		std::vector<HDF5VTKDataNode<double>> point_data_;
+		size_t n_point_data_;
+		std::vector<HDF5VTKDataNode<double>> cell_data_;
+		size_t n_cell_data_;
+
+		HDF5VTKDataNode<double> &next_node(const bool is_point);
+
+		/// cells == nullptr writes the implicit topology 0, 1, ..., n_cells - 1
+		void write_topology(const std::string &grp, const hsize_t n_cells, const hsize_t n_cell_vertices, const Eigen::MatrixXi *cells, HDF5File &file);
+		void write(const Eigen::MatrixXd &points, const std::string &grp, const hsize_t n_cells, const hsize_t n_cell_vertices, const Eigen::MatrixXi *cells, HDF5File &file);
+	};
+} // namespace paraviewo
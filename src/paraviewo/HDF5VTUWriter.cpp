@@ -1,249 +1,587 @@
 #include "HDF5VTUWriter.hpp"
 
+#include "NodeOrdering.hpp"
+
 namespace paraviewo
 {
 
+	void write_hdf5_points(const Eigen::MatrixXd &points, HDF5File &file, const std::string &grp)
+	{
+		const hsize_t n_points = points.rows();
+		const hsize_t dim = points.cols();
+		assert(dim <= 3);
+
+		// Written column by column straight from the column-major points, a 2D z is filled with zeros
+		const hid_t dset = file.create_dataset("/" + grp + "/Points", H5T_NATIVE_DOUBLE, {n_points, 3});
+		const hsize_t block = file.block_rows(dset);
+		const std::vector<double> zeros(dim < 3 ? std::min(block, n_points) : 0, 0.);
+
+		for (hsize_t begin = 0; begin < n_points; begin += block)
+		{
+			const hsize_t n = std::min(block, n_points - begin);
+			file.write_columns(dset, H5T_NATIVE_DOUBLE, points.data() + begin, n_points, begin, n, 0, dim, 3);
+			for (hsize_t d = dim; d < 3; ++d)
+				file.write_columns(dset, H5T_NATIVE_DOUBLE, zeros.data(), 0, begin, n, d, 1, 3);
+		}
+		file.release_dataset(dset);
+	}
+
 	HDF5VTUWriter::HDF5VTUWriter(bool binary)
+		: adaptive_target_(0), time_budget_(0), zero_copy_(false), persistent_(false), n_point_data_(0), n_cell_data_(0)
 	{
 	}
 
-	void HDF5VTUWriter::write_data(h5pp::File &file)
+	void HDF5VTUWriter::set_persistent(const bool persistent)
 	{
+		if (!persistent)
+			close();
+		persistent_ = persistent;
+	}
+
+	bool HDF5VTUWriter::close()
+	{
+		if (!persistent_file_)
+			return true;
+
+		const bool ok = persistent_file_->close();
+		persistent_file_.reset();
+		persistent_path_.clear();
+		return ok;
+	}
+
+	void HDF5VTUWriter::write_data(HDF5File &file, const std::string &grp)
+	{
+		int64_t raw_bytes = 0;
+		for (size_t i = 0; i < n_point_data_; ++i)
+			raw_bytes += point_data_[i].raw_bytes();
+		for (size_t i = 0; i < n_cell_data_; ++i)
+			raw_bytes += cell_data_[i].raw_bytes();
+		file.set_adaptive_compression(adaptive_compression_target(adaptive_target_, time_budget_, raw_bytes));
+
 		if (!current_scalar_point_data_.empty() || !current_vector_point_data_.empty())
 		{
-			for (auto it = point_data_.begin(); it != point_data_.end(); ++it)
+			for (size_t i = 0; i < n_point_data_; ++i)
 			{
-				it->write(file);
+				point_data_[i].write(file, &stats_, grp);
 			}
 		}
 
 		if (!current_scalar_cell_data_.empty() || !current_vector_cell_data_.empty())
 		{
-			for (auto it = cell_data_.begin(); it != cell_data_.end(); ++it)
+			for (size_t i = 0; i < n_cell_data_; ++i)
 			{
-				it->write(file);
+				cell_data_[i].write(file, &stats_, grp);
 			}
 		}
 	}
 
-	void HDF5VTUWriter::write_header(const int n_vertices, const int n_elements, const std::string &grp, h5pp::File &file)
+	void HDF5VTUWriter::write_header(const int64_t n_vertices, const int64_t n_elements, const std::string &grp, HDF5File &file)
 	{
-		std::string tmp = "UnstructuredGrid";
-		file.writeAttribute(std::array<int64_t, 2>{{1, 0}}, grp, "Version");
-		file.writeAttribute(tmp, grp, "Type", 16);
-
-		file.writeDataset(std::array<int64_t, 1>{{n_vertices}}, grp + "/NumberOfPoints");
-		file.writeDataset(std::array<int64_t, 1>{{n_elements}}, grp + "/NumberOfCells");
+		const std::array<int64_t, 2> version = {{1, 0}};
+		file.write_attribute(grp, "Version", version.data(), version.size());
+		file.write_attribute(grp, "Type", "UnstructuredGrid");
+
+		const int64_t n_points = n_vertices;
+		file.write_dataset(grp + "/NumberOfPoints", &n_points, {1});
+		const int64_t n_cells = n_elements;
+		file.write_dataset(grp + "/NumberOfCells", &n_cells, {1});
 	}
 
-	void HDF5VTUWriter::write_points(const Eigen::MatrixXd &points, h5pp::File &file)
+	void HDF5VTUWriter::write_points(const Eigen::MatrixXd &points, const std::string &grp, HDF5File &file)
 	{
-		Eigen::MatrixXd tmp(points.rows(), 3);
-
-		for (int d = 0; d < points.rows(); ++d)
-		{
-			for (int i = 0; i < points.cols(); ++i)
-			{
-				tmp(d, i) = points(d, i);
-			}
-
-			if (!(points.cols() == 3))
-				tmp(d, 2) = 0;
-		}
-
-		file.writeDataset(tmp, "/VTKHDF/Points");
+		write_hdf5_points(points, file, grp);
 	}
 
-	void HDF5VTUWriter::write_cells(const Eigen::MatrixXi &cells, const CellType ctype, const std::string &grp, h5pp::File &file)
+	void HDF5VTUWriter::write_cells(const Eigen::MatrixXi &cells, const CellType ctype, const std::string &grp, HDF5File &file)
 	{
-		const int n_cells = cells.rows();
-		const int n_cell_vertices = cells.cols();
-		int index;
-
-		file.writeDataset(std::array<int64_t, 1>{{n_cells * n_cell_vertices}}, grp + "/NumberOfConnectivityIds");
-		Eigen::Matrix<int64_t, Eigen::Dynamic, 1> connectivity_array(n_cells * n_cell_vertices);
-		index = 0;
-
-		for (int c = 0; c < n_cells; ++c)
+		const hsize_t n_cells = cells.rows();
+		const hsize_t n_cell_vertices = cells.cols();
+
+		const int64_t n_connectivity = n_cells * n_cell_vertices;
+		file.write_dataset(grp + "/NumberOfConnectivityIds", &n_connectivity, {1});
+
+		// Strided writes from the column-major cells, HDF5 converts the indices to int64 on the fly.
+		// Cells in another node order are gathered column by column: column j of the file is column perm[j].
+		NodePermutations permutations(node_ordering());
+		const int *perm = permutations.get(ctype, n_cell_vertices);
+		hid_t dset = file.create_index_dataset("/" + grp + "/Connectivity", n_cells * n_cell_vertices);
+		const hsize_t block = std::max<hsize_t>(1, file.block_rows(dset) / std::max<hsize_t>(1, n_cell_vertices));
+		for (hsize_t begin = 0; begin < n_cells; begin += block)
 		{
-			for (int i = 0; i < n_cell_vertices; ++i)
+			const hsize_t n = std::min(block, n_cells - begin);
+			if (perm)
 			{
-				const int64_t v_index = cells(c, i);
-				connectivity_array[index++] = v_index;
+				for (hsize_t j = 0; j < n_cell_vertices; ++j)
+					file.write_columns(dset, H5T_NATIVE_INT, cells.data() + perm[j] * n_cells + begin, n_cells, begin, n, j, 1, n_cell_vertices);
 			}
+			else
+				file.write_columns(dset, H5T_NATIVE_INT, cells.data() + begin, n_cells, begin, n, 0, n_cell_vertices, n_cell_vertices);
 		}
-
-		assert(index == n_cells * n_cell_vertices);
-		assert(connectivity_array.size() == n_cells * n_cell_vertices);
-
-		file.writeDataset(connectivity_array, "/VTKHDF/Connectivity");
+		file.release_dataset(dset);
 
 		/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-		const int int_tag = paraview_tags::VTKTag(n_cell_vertices, ctype);
-		Eigen::Matrix<uint8_t, Eigen::Dynamic, 1> type_array(n_cells);
-		type_array.setConstant(int_tag);
-		file.writeDataset(type_array, "/VTKHDF/Types");
+		const uint8_t tag = paraview_tags::VTKTag(n_cell_vertices, ctype);
+		dset = file.create_dataset("/" + grp + "/Types", H5T_NATIVE_UINT8, {n_cells});
+		file.write_blocks<uint8_t>(dset, n_cells, 1, [&](const hsize_t begin, const hsize_t end, uint8_t *out) {
+			std::fill(out, out + (end - begin), tag);
+		});
+		file.release_dataset(dset);
 
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		Eigen::Matrix<int64_t, Eigen::Dynamic, 1> offset_array(n_cells + 1);
-		index = 0;
-
-		int64_t acc = n_cell_vertices;
-		offset_array[index++] = 0;
-		for (int i = 0; i < n_cells; ++i)
-		{
-			offset_array[index++] = acc;
-			acc += n_cell_vertices;
-		}
-
-		assert(index == n_cells + 1);
-		assert(offset_array.size() == n_cells + 1);
-
-		file.writeDataset(offset_array, "/VTKHDF/Offsets");
+		dset = file.create_index_dataset("/" + grp + "/Offsets", n_cells + 1);
+		file.write_blocks<int64_t>(dset, n_cells + 1, 1, [&](const hsize_t begin, const hsize_t end, int64_t *out) {
+			for (hsize_t i = begin; i < end; ++i)
+				*out++ = i * n_cell_vertices;
+		});
+		file.release_dataset(dset);
 	}
 
-	void HDF5VTUWriter::write_cells(const std::vector<CellElement> &cells, const std::string &grp, h5pp::File &file)
+	void HDF5VTUWriter::write_cells(const std::vector<CellElement> &cells, const std::string &grp, HDF5File &file)
 	{
-		const int n_cells = cells.size();
-		int index;
+		const int64_t n_cells = cells.size();
+		Workspace::Scope scope(workspace());
 
-		int n_cells_indices = 0;
-		for (const auto &c : cells)
-		{
-			n_cells_indices += c.vertices.size();
-		}
-		file.writeDataset(std::array<int64_t, 1>{{n_cells_indices}}, grp + "/NumberOfConnectivityIds");
+		// Offsets first: they give the size of the connectivity
+		int64_t *offset_array = workspace().allocate<int64_t>(n_cells + 1);
+		offset_array[0] = 0;
+		for (int64_t i = 0; i < n_cells; ++i)
+			offset_array[i + 1] = offset_array[i] + cells[i].vertices.size();
+
+		const int64_t n_connectivity = offset_array[n_cells];
+		file.write_dataset(grp + "/NumberOfConnectivityIds", &n_connectivity, {1});
 
-		Eigen::Matrix<int64_t, Eigen::Dynamic, 1> connectivity_array(n_cells_indices);
-		index = 0;
+		NodePermutations permutations(node_ordering());
+		int64_t *connectivity_array = workspace().allocate<int64_t>(n_connectivity);
+		int64_t index = 0;
 		for (const auto &c : cells)
 		{
-			for (const int i : c.vertices)
-				connectivity_array[index++] = i;
+			const int n_vertices = c.vertices.size();
+			const int *perm = permutations.get(c.ctype, n_vertices);
+			for (int j = 0; j < n_vertices; ++j)
+				connectivity_array[index++] = c.vertices[perm ? perm[j] : j];
 		}
+		assert(index == n_connectivity);
 
-		assert(index == n_cells_indices);
-		assert(connectivity_array.size() == n_cells_indices);
-
-		file.writeDataset(connectivity_array, "/VTKHDF/Connectivity");
+		file.write_index_dataset("/" + grp + "/Connectivity", connectivity_array, n_connectivity);
 
 		/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		Eigen::Matrix<uint8_t, Eigen::Dynamic, 1> type_array(n_cells);
-		index = 0;
-
-		for (int i = 0; i < n_cells; ++i)
+		uint8_t *type_array = workspace().allocate<uint8_t>(n_cells);
+		for (int64_t i = 0; i < n_cells; ++i)
 		{
 			const int int_tag = paraview_tags::VTKTag(cells[i].vertices.size(), cells[i].ctype);
-			const uint8_t tag = int_tag;
-			type_array[index++] = tag;
+			type_array[i] = int_tag;
 		}
 
-		assert(index == n_cells);
-		assert(type_array.size() == n_cells);
-
-		file.writeDataset(type_array, "/VTKHDF/Types");
+		file.write_dataset("/" + grp + "/Types", type_array, {hsize_t(n_cells)});
 
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		Eigen::Matrix<int64_t, Eigen::Dynamic, 1> offset_array(n_cells + 1);
-		index = 0;
+		file.write_index_dataset("/" + grp + "/Offsets", offset_array, n_cells + 1);
+	}
 
-		int64_t acc = 0;
-		offset_array[index++] = acc;
-		for (int i = 0; i < n_cells; ++i)
-		{
-			acc += cells[i].vertices.size();
-			offset_array[index++] = acc;
-		}
+	void HDF5VTUWriter::write_cells(const PolyhedralCells &cells, const std::string &grp, HDF5File &file)
+	{
+		const int64_t n_cells = cells.n_cells();
+		Workspace::Scope scope(workspace());
+
+		// The connectivity of a polyhedron lists its points, the faces refer to them
+		const PolyhedronPoints points = polyhedron_points(cells, n_threads_, workspace());
+		const int64_t n_connectivity = points.offsets[n_cells];
+		file.write_dataset(grp + "/NumberOfConnectivityIds", &n_connectivity, {1});
+		file.write_index_dataset("/" + grp + "/Connectivity", points.points, n_connectivity);
+
+		hid_t dset = file.create_dataset("/" + grp + "/Types", H5T_NATIVE_UINT8, {hsize_t(n_cells)});
+		file.write_blocks<uint8_t>(dset, n_cells, 1, [&](const hsize_t begin, const hsize_t end, uint8_t *out) {
+			for (hsize_t i = begin; i < end; ++i)
+				*out++ = paraview_tags::VTKTag(points.offsets[i + 1] - points.offsets[i], CellType::Polyhedron);
+		});
+		file.release_dataset(dset);
 
-		assert(index == n_cells + 1);
-		assert(offset_array.size() == n_cells + 1);
+		file.write_index_dataset("/" + grp + "/Offsets", points.offsets, n_cells + 1);
 
-		file.writeDataset(offset_array, "/VTKHDF/Offsets");
+		/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// Faces in compressed rows, as given
+		const std::array<int64_t, 2> version = {{2, 3}};
+		file.write_attribute(grp, "Version", version.data(), version.size());
+
+		const int64_t n_faces = cells.n_faces();
+		const int64_t n_face_connectivity = cells.face_vertices.size();
+		const int64_t n_polyhedron_faces = cells.cell_faces.size();
+		file.write_dataset(grp + "/NumberOfFaces", &n_faces, {1});
+		file.write_dataset(grp + "/NumberOfFaceConnectivityIds", &n_face_connectivity, {1});
+		file.write_dataset(grp + "/NumberOfPolyhedronToFaceIds", &n_polyhedron_faces, {1});
+
+		file.write_index_dataset("/" + grp + "/FaceConnectivity", cells.face_vertices.data(), n_face_connectivity);
+		file.write_index_dataset("/" + grp + "/FaceOffsets", cells.face_offsets.data(), n_faces + 1);
+		file.write_index_dataset("/" + grp + "/PolyhedronToFaces", cells.cell_faces.data(), n_polyhedron_faces);
+		file.write_index_dataset("/" + grp + "/PolyhedronOffsets", cells.cell_offsets.data(), n_cells + 1);
 	}
 
 	void HDF5VTUWriter::clear()
 	{
-		point_data_.clear();
-		cell_data_.clear();
+		n_point_data_ = 0;
+		n_cell_data_ = 0;
+	}
+
+	HDF5VTKDataNode<double> &HDF5VTUWriter::next_node(const bool is_point)
+	{
+		std::vector<HDF5VTKDataNode<double>> &nodes = is_point ? point_data_ : cell_data_;
+		size_t &n_nodes = is_point ? n_point_data_ : n_cell_data_;
+		if (n_nodes == nodes.size())
+			nodes.push_back(HDF5VTKDataNode<double>(is_point));
+		return nodes[n_nodes++];
+	}
+
+	bool HDF5VTUWriter::session_field(const HDF5VTKDataNode<double> &node)
+	{
+		if (!session_file_)
+			return false;
+
+		// The fields to come are unknown, the time budget applies to each field
+		session_file_->set_adaptive_compression(adaptive_compression_target(adaptive_target_, time_budget_, node.raw_bytes()));
+		node.write(*session_file_, &stats_);
+		session_file_->flush();
+		return true;
 	}
 
 	void HDF5VTUWriter::add_scalar_field(const std::string &name, const Eigen::MatrixXd &data)
 	{
-		point_data_.push_back(HDF5VTKDataNode<double>(true));
-		point_data_.back().initialize(name, data);
+		if (session_file_)
+		{
+			HDF5VTKDataNode<double> node(true);
+			node.initialize(name, data, true);
+			node.set_precision(field_precision(name));
+			session_field(node);
+			return;
+		}
+
+		HDF5VTKDataNode<double> &node = next_node(true);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
 		current_scalar_point_data_ = name;
 	}
 
 	void HDF5VTUWriter::add_vector_field(const std::string &name, const Eigen::MatrixXd &data)
 	{
-		point_data_.push_back(HDF5VTKDataNode<double>(true));
-
-		Eigen::MatrixXd tmp = data;
-
-		if (data.cols() == 2)
+		if (session_file_)
 		{
-			tmp.conservativeResize(tmp.rows(), 3);
-			tmp.col(2).setZero();
+			HDF5VTKDataNode<double> node(true);
+			node.initialize(name, data, true);
+			node.set_precision(field_precision(name));
+			session_field(node);
+			return;
 		}
 
-		point_data_.back().initialize(name, tmp);
+		// 2D vectors are padded when written
+		HDF5VTKDataNode<double> &node = next_node(true);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
 		current_vector_point_data_ = name;
 	}
 
 	void HDF5VTUWriter::add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data)
 	{
-		cell_data_.push_back(HDF5VTKDataNode<double>(false));
-		cell_data_.back().initialize(name, data);
+		if (session_file_)
+		{
+			HDF5VTKDataNode<double> node(false);
+			node.initialize(name, data, true);
+			node.set_precision(field_precision(name));
+			session_field(node);
+			return;
+		}
+
+		HDF5VTKDataNode<double> &node = next_node(false);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
 		current_scalar_cell_data_ = name;
 	}
 
 	void HDF5VTUWriter::add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data)
 	{
-		cell_data_.push_back(HDF5VTKDataNode<double>(false));
+		if (session_file_)
+		{
+			HDF5VTKDataNode<double> node(false);
+			node.initialize(name, data, true);
+			node.set_precision(field_precision(name));
+			session_field(node);
+			return;
+		}
 
-		Eigen::MatrixXd tmp = data;
+		HDF5VTKDataNode<double> &node = next_node(false);
+		node.initialize(name, data, zero_copy_);
+		node.set_precision(field_precision(name));
+		current_vector_cell_data_ = name;
+	}
 
-		if (data.cols() == 2)
+	bool HDF5VTUWriter::create_file(const std::string &path, const bool in_memory, HDF5File &file) const
+	{
+		return file.create_vtkhdf(path, in_memory, file_settings_, &workspace());
+	}
+
+	HDF5File *HDF5VTUWriter::open_file(const std::string &path, std::unique_ptr<HDF5File> &file)
+	{
+		if (!persistent_)
 		{
-			tmp.conservativeResize(tmp.rows(), 3);
-			tmp.col(2).setZero();
+			file = std::make_unique<HDF5File>();
+			return create_file(path, false, *file) ? file.get() : nullptr;
 		}
 
-		cell_data_.back().initialize(name, tmp);
-		current_vector_cell_data_ = name;
+		if (persistent_file_ && persistent_path_ == path)
+		{
+			persistent_file_->set_workspace(&workspace());
+			return persistent_file_.get();
+		}
+
+		close();
+		persistent_file_ = std::make_unique<HDF5File>();
+		persistent_file_->set_reuse_datasets(true);
+		if (!create_file(path, false, *persistent_file_))
+		{
+			persistent_file_.reset();
+			return nullptr;
+		}
+		persistent_path_ = path;
+		return persistent_file_.get();
+	}
+
+	bool HDF5VTUWriter::close_file(HDF5File &file)
+	{
+		if (!persistent_)
+			return file.close();
+
+		// Fields not written in this step would be stale
+		file.remove_unused_datasets();
+		file.flush();
+		return true;
+	}
+
+	void HDF5VTUWriter::add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point)
+	{
+		HDF5VTKDataNode<double> node(is_point);
+		node.initialize(name, n_rows, n_components, fill, n_threads_);
+		node.set_precision(field_precision(name));
+
+		if (session_field(node))
+			return;
+
+		HDF5VTKDataNode<double> &next = next_node(is_point);
+		next.initialize(name, n_rows, n_components, fill, n_threads_);
+		next.set_precision(field_precision(name));
+
+		if (is_point)
+			(n_components == 1 ? current_scalar_point_data_ : current_vector_point_data_) = name;
+		else
+			(n_components == 1 ? current_scalar_cell_data_ : current_vector_cell_data_) = name;
 	}
 
 	bool HDF5VTUWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
 	{
-		h5pp::File file(path, h5pp::FileAccess::REPLACE);
-		file.setCompressionLevel(5);
-		file.createGroup("VTKHDF");
+		std::unique_ptr<HDF5File> tmp;
+		HDF5File *file = open_file(path, tmp);
+		if (!file)
+			return false;
+
+		begin_write();
+		write_header(points.rows(), cells.rows(), "VTKHDF", *file);
+		write_points(points, "VTKHDF", *file);
+		write_data(*file, "VTKHDF");
+		write_cells(cells, ctype, "VTKHDF", *file);
+
+		end_write();
+		clear();
+		return close_file(*file);
+	}
+
+	bool HDF5VTUWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		std::unique_ptr<HDF5File> tmp;
+		HDF5File *file = open_file(path, tmp);
+		if (!file)
+			return false;
+
+		begin_write();
+		write_header(points.rows(), cells.size(), "VTKHDF", *file);
+		write_points(points, "VTKHDF", *file);
+		write_data(*file, "VTKHDF");
+		write_cells(cells, "VTKHDF", *file);
+
+		end_write();
+		clear();
+		return close_file(*file);
+	}
+
+	bool HDF5VTUWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const PolyhedralCells &cells)
+	{
+		std::unique_ptr<HDF5File> tmp;
+		HDF5File *file = open_file(path, tmp);
+		if (!file)
+			return false;
+
+		begin_write();
+		write_header(points.rows(), cells.n_cells(), "VTKHDF", *file);
+		write_points(points, "VTKHDF", *file);
+		write_data(*file, "VTKHDF");
+		write_cells(cells, "VTKHDF", *file);
+
+		end_write();
+		clear();
+		return close_file(*file);
+	}
+
+	bool HDF5VTUWriter::write_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		begin_write();
+		HDF5File file;
+		if (!create_file("paraviewo.hdf", true, file))
+			return false;
 
 		write_header(points.rows(), cells.rows(), "VTKHDF", file);
-		write_points(points, file);
-		write_data(file);
+		write_points(points, "VTKHDF", file);
+		write_data(file, "VTKHDF");
 		write_cells(cells, ctype, "VTKHDF", file);
 
-		file.flush();
+		end_write();
 		clear();
-		return true;
+		return file.write_image(sink);
 	}
 
-	bool HDF5VTUWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	bool HDF5VTUWriter::write_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
 	{
-		h5pp::File file(path, h5pp::FileAccess::REPLACE);
-		file.setCompressionLevel(5);
-		file.createGroup("VTKHDF");
+		begin_write();
+		HDF5File file;
+		if (!create_file("paraviewo.hdf", true, file))
+			return false;
 
 		write_header(points.rows(), cells.size(), "VTKHDF", file);
-		write_points(points, file);
-		write_data(file);
+		write_points(points, "VTKHDF", file);
+		write_data(file, "VTKHDF");
 		write_cells(cells, "VTKHDF", file);
 
-		file.flush();
+		end_write();
+		clear();
+		return file.write_image(sink);
+	}
+
+	bool HDF5VTUWriter::write_mesh(Sink &sink, const Eigen::MatrixXd &points, const PolyhedralCells &cells)
+	{
+		begin_write();
+		HDF5File file;
+		if (!create_file("paraviewo.hdf", true, file))
+			return false;
+
+		write_header(points.rows(), cells.n_cells(), "VTKHDF", file);
+		write_points(points, "VTKHDF", file);
+		write_data(file, "VTKHDF");
+		write_cells(cells, "VTKHDF", file);
+
+		end_write();
+		clear();
+		return file.write_image(sink);
+	}
+
+	void HDF5VTUWriter::write_group(HDF5File &file, const std::string &grp, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype, const bool with_geometry)
+	{
+		begin_write();
+		if (with_geometry)
+		{
+			write_header(points.rows(), cells.rows(), grp, file);
+			write_points(points, grp, file);
+		}
+		write_data(file, grp);
+		if (with_geometry)
+			write_cells(cells, ctype, grp, file);
+
+		end_write();
 		clear();
+	}
+
+	void HDF5VTUWriter::write_group(HDF5File &file, const std::string &grp, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells, const bool with_geometry)
+	{
+		begin_write();
+		if (with_geometry)
+		{
+			write_header(points.rows(), cells.size(), grp, file);
+			write_points(points, grp, file);
+		}
+		write_data(file, grp);
+		if (with_geometry)
+			write_cells(cells, grp, file);
+
+		end_write();
+		clear();
+	}
+
+	bool HDF5VTUWriter::begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		end_mesh();
+		begin_write();
+		session_file_ = open_file(path, session_owned_file_);
+		if (!session_file_)
+			return false;
+
+		write_header(points.rows(), cells.rows(), "VTKHDF", *session_file_);
+		write_points(points, "VTKHDF", *session_file_);
+		write_cells(cells, ctype, "VTKHDF", *session_file_);
+		return true;
+	}
+
+	bool HDF5VTUWriter::begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		end_mesh();
+		begin_write();
+		session_file_ = open_file(path, session_owned_file_);
+		if (!session_file_)
+			return false;
+
+		write_header(points.rows(), cells.size(), "VTKHDF", *session_file_);
+		write_points(points, "VTKHDF", *session_file_);
+		write_cells(cells, "VTKHDF", *session_file_);
+		return true;
+	}
+
+	bool HDF5VTUWriter::begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		end_mesh();
+		begin_write();
+		session_owned_file_ = std::make_unique<HDF5File>();
+		if (!create_file("paraviewo.hdf", true, *session_owned_file_))
+			return false;
+		session_file_ = session_owned_file_.get();
+		session_sink_ = &sink;
+
+		write_header(points.rows(), cells.rows(), "VTKHDF", *session_file_);
+		write_points(points, "VTKHDF", *session_file_);
+		write_cells(cells, ctype, "VTKHDF", *session_file_);
+		return true;
+	}
+
+	bool HDF5VTUWriter::begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		end_mesh();
+		begin_write();
+		session_owned_file_ = std::make_unique<HDF5File>();
+		if (!create_file("paraviewo.hdf", true, *session_owned_file_))
+			return false;
+		session_file_ = session_owned_file_.get();
+		session_sink_ = &sink;
+
+		write_header(points.rows(), cells.size(), "VTKHDF", *session_file_);
+		write_points(points, "VTKHDF", *session_file_);
+		write_cells(cells, "VTKHDF", *session_file_);
 		return true;
 	}
 
+	bool HDF5VTUWriter::end_mesh()
+	{
+		if (!session_file_)
+			return false;
+
+		end_write();
+		const bool ok = session_sink_ ? session_file_->write_image(*session_sink_) : close_file(*session_file_);
+
+		session_file_ = nullptr;
+		session_sink_ = nullptr;
+		session_owned_file_.reset();
+		return ok;
+	}
 } // namespace paraviewo
@@ -1,8 +1,8 @@
 #pragma once
 
 #include "ParaviewWriter.hpp"
-
-#include <h5pp/h5pp.h>
+#include "HDF5File.hpp"
+#include "Polyhedra.hpp"
 
 #include <Eigen/Dense>
 
@@ -12,6 +12,7 @@
 #include <vector>
 #include <array>
 #include <cassert>
+#include <memory>
 
 
 namespace paraviewo
@@ -23,46 +24,148 @@ namespace paraviewo
 
 	public:
 		HDF5VTKDataNode(const bool is_point)
-			: is_point_(is_point)
+			: is_point_(is_point), borrowed_(nullptr), n_components_(0), n_rows_(0), n_threads_(1)
 		{
 		}
 
 		HDF5VTKDataNode(const bool is_point, const std::string &name, const Eigen::MatrixXd &data = Eigen::MatrixXd())
-			: is_point_(is_point), name_(name), data_(data)
+			: is_point_(is_point), name_(name), data_(data), borrowed_(nullptr), n_components_(0), n_rows_(0), n_threads_(1)
 		{
 		}
 
 		// const inline Eigen::MatrixXd &data() { return data_; }
 
-		void initialize(const std::string &name, const Eigen::MatrixXd &data)
+		/// With borrow the data is not copied, it must outlive the call to write. A copy reuses the storage of
+		/// the node when the size does not change.
+		void initialize(const std::string &name, const Eigen::MatrixXd &data, const bool borrow = false)
 		{
 			name_ = name;
-			data_ = data;
+			n_rows_ = 0;
+			generator_ = nullptr;
+			if (borrow)
+				borrowed_ = &data;
+			else
+			{
+				data_ = data;
+				borrowed_ = nullptr;
+			}
+		}
+
+		/// Lazy data, evaluated block by block (with n_threads threads) when written
+		void initialize(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &generator, const int n_threads = 1)
+		{
+			name_ = name;
+			borrowed_ = nullptr;
+			n_rows_ = n_rows;
+			n_components_ = n_components;
+			generator_ = generator;
+			n_threads_ = n_threads;
+		}
+
+		/// Precision applied to the values while they are written
+		inline void set_precision(const FieldPrecision &precision) { precision_ = precision; }
+
+		/// Stores the field as an N-D array of shape grid (slowest varying first) with the given chunk shape,
+		/// instead of a list of rows. Used by the regular grid writers.
+		void set_grid(const std::vector<hsize_t> &grid, const std::vector<hsize_t> &chunk)
+		{
+			grid_ = grid;
+			chunk_ = chunk;
 		}
 
-		void write(h5pp::File &file) const
+		/// Goes through a bounded staging buffer: 2D vectors are padded to 3D and the precision is applied.
+		/// With adaptive compression, the level chosen for the field is appended to stats. The field goes to
+		/// the PointData or CellData group of grp.
+		void write(HDF5File &file, WriteStats *stats = nullptr, const std::string &grp = "VTKHDF") const
 		{
+			// Rows evaluated to choose the adaptive compression level
+			static const hsize_t SAMPLE_BYTES = 256 << 10;
+
 			const std::string key = is_point_ ? "PointData" : "CellData";
+			const Eigen::MatrixXd &data = borrowed_ ? *borrowed_ : data_;
 
-			assert(data_.cols() == 1 || data_.cols() == 3);
-			if (data_.cols() == 3)
-				file.writeDataset(data_, "/VTKHDF/" + key + "/" + name_);
-			else
+			const int64_t n_rows = generator_ ? n_rows_ : data.rows();
+			const int n_components = generator_ ? n_components_ : data.cols();
+			const FieldGenerator fill = generator_ ? generator_ : matrix_generator(data);
+
+			assert(n_components == 1 || n_components == 2 || n_components == 3 || n_components == 6 || n_components == 9);
+			const hsize_t out_components = padded_components(n_components);
+			std::vector<hsize_t> dims = grid_.empty() ? std::vector<hsize_t>{hsize_t(n_rows)} : grid_;
+			std::vector<hsize_t> chunk = chunk_;
+
+			// Rows of the field in one entry of the first dimension
+			hsize_t slice = 1;
+			for (size_t i = 1; i < dims.size(); ++i)
+				slice *= dims[i];
+			assert(dims[0] * slice == hsize_t(n_rows));
+
+			if (out_components > 1)
 			{
-				Eigen::Matrix<T, Eigen::Dynamic, 1> tmp = data_.col(0);
-				file.writeDataset(tmp, "/VTKHDF/" + key + "/" + name_);
+				dims.push_back(out_components);
+				if (!chunk.empty())
+					chunk.push_back(out_components);
 			}
+
+			const std::string path = "/" + grp + "/" + key + "/" + name_;
+			int level = file.compression_level();
+			if (file.adaptive_compression())
+			{
+				const hsize_t row_size = slice * out_components;
+				const hsize_t sample_rows = std::min<hsize_t>(dims[0], std::max<hsize_t>(1, SAMPLE_BYTES / (row_size * sizeof(T))));
+				Workspace::Scope scope(file.workspace());
+				T *sample = file.workspace().allocate<T>(sample_rows * row_size);
+				generate_field_block(fill, n_components, 0, sample_rows * slice, n_threads_, sample, precision_);
+
+				ArrayCompression choice;
+				choice.name = path;
+				level = file.choose_compression_level(hdf5_native_type<T>(), sample, sample_rows * row_size, choice);
+				if (stats)
+					stats->arrays.push_back(choice);
+			}
+
+			const hid_t dset = file.create_dataset(path, hdf5_native_type<T>(), dims, chunk, level);
+			file.write_blocks<T>(dset, dims[0], slice * out_components, [&](const hsize_t begin, const hsize_t end, T *out) {
+				generate_field_block(fill, n_components, begin * slice, end * slice, n_threads_, out, precision_);
+			});
+			file.release_dataset(dset);
 		}
 
-		inline bool empty() const { return data_.size() <= 0; }
+		inline bool empty() const { return generator_ ? n_rows_ <= 0 : (borrowed_ ? borrowed_->size() : data_.size()) <= 0; }
+		/// Number of points or cells the field covers
+		inline int64_t n_rows() const { return generator_ ? n_rows_ : (borrowed_ ? borrowed_->rows() : data_.rows()); }
+
+		/// Size of the written array before compression
+		inline int64_t raw_bytes() const
+		{
+			const Eigen::MatrixXd &data = borrowed_ ? *borrowed_ : data_;
+			return generator_ ? n_rows_ * padded_components(n_components_) * sizeof(T) : data.rows() * padded_components(data.cols()) * sizeof(T);
+		}
 
 	private:
 		const bool is_point_;
 		std::string name_;
 		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> data_;
+		const Eigen::MatrixXd *borrowed_;
 		int n_components_;
+
+		int64_t n_rows_;
+		FieldGenerator generator_;
+		int n_threads_;
+		FieldPrecision precision_;
+
+		std::vector<hsize_t> grid_;
+		std::vector<hsize_t> chunk_;
 	};
 
+	/// Writes grp/Points (n x 3) directly from the column-major points, 2D points get z = 0
+	void write_hdf5_points(const Eigen::MatrixXd &points, HDF5File &file, const std::string &grp = "VTKHDF");
+
+	/// Throughput needed to compress raw_bytes within time_budget seconds (if positive), at least target_mb_per_s
+	inline double adaptive_compression_target(const double target_mb_per_s, const double time_budget, const int64_t raw_bytes)
+	{
+		return time_budget > 0 ? std::max(target_mb_per_s, raw_bytes / time_budget / 1e6) : target_mb_per_s;
+	}
+
 	class HDF5VTUWriter : public ParaviewWriter
 	{
 	public:
@@ -73,7 +176,57 @@ namespace paraviewo
 		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
 		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
 
+		/// The file is assembled in memory with the HDF5 core driver, then its image is written to the sink
+		bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
+		bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
+
+		/// Polyhedral mesh, the faces are written in the FaceConnectivity, FaceOffsets, PolyhedronToFaces and
+		/// PolyhedronOffsets datasets (VTKHDF 2.3)
+		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const PolyhedralCells &cells);
+		bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const PolyhedralCells &cells);
+
+		/// In a session fields are written to the file as soon as they are added, without any copy
+		bool begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
+		bool begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
+		bool begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
+		bool begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
+		bool end_mesh() override;
+
 		void clear() override;
+		bool uses_hdf5() const override { return true; }
+
+		/// Builds the whole file in memory (HDF5 core driver) and writes it to disk with one large sequential write,
+		/// avoids the many small writes and metadata operations hitting the (parallel) file system
+		inline void set_core_staging(const bool staging) { file_settings_.core_staging = staging; }
+		/// Paged file space aggregation (e.g., 1 << 20), 0 disables it
+		inline void set_page_size(const size_t page_size) { file_settings_.page_size = page_size; }
+		/// Latest HDF5 file format, more compact metadata but requires a recent HDF5 to read
+		inline void set_latest_format(const bool latest) { file_settings_.latest_format = latest; }
+		/// Filters applied to Connectivity and Offsets before compression, see IndexPreconditioning
+		inline void set_index_preconditioning(const IndexPreconditioning preconditioning) { file_settings_.index_preconditioning = preconditioning; }
+		/// Chooses the deflate level of every field from a sample, the best ratio compressing at target_mb_per_s at least
+		/// (0 disables it). The choices are reported in last_write_stats. Reused datasets of the persistent mode keep
+		/// the level chosen when they were created. Only PointData and CellData are tuned, the geometry and topology
+		/// arrays (Points, Connectivity, Offsets, Types) keep the fixed level.
+		inline void set_adaptive_compression(const double target_mb_per_s) { adaptive_target_ = target_mb_per_s; }
+		/// Time allowed to compress the fields of one write_mesh, turned into a throughput target (0 disables it)
+		inline void set_compression_time_budget(const double seconds) { time_budget_ = seconds; }
+
+		/// Keeps the file and its datasets open between write_mesh calls to the same path: datasets are overwritten
+		/// (or resized) in place and flushed at the end of each write. Only applies to writes to a path.
+		void set_persistent(const bool persistent);
+		/// Closes the file kept open in persistent mode
+		bool close();
+
+		/// Fields are referenced instead of copied: the matrices passed to add_field must stay alive until write_mesh
+		inline void set_zero_copy(const bool zero_copy) { zero_copy_ = zero_copy; }
+
+		/// Creates a file with the settings of the writer (e.g., to hold several meshes written with write_group)
+		bool create_file(const std::string &path, const bool in_memory, HDF5File &file) const;
+		/// Writes the mesh and the fields added so far into the group grp of an open file, as an UnstructuredGrid.
+		/// Without geometry only the fields are written (e.g., time steps of a static mesh).
+		void write_group(HDF5File &file, const std::string &grp, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype, const bool with_geometry = true);
+		void write_group(HDF5File &file, const std::string &grp, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells, const bool with_geometry = true);
 
 	protected:
 		void add_scalar_field(const std::string &name, const Eigen::MatrixXd &data) override;
@@ -82,20 +235,46 @@ namespace paraviewo
 		void add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
 		void add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
 
+		void add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point) override;
+
 	private:
+		HDF5FileSettings file_settings_;
+		double adaptive_target_;
+		double time_budget_;
+
+		bool zero_copy_;
+
+		bool persistent_;
+		std::unique_ptr<HDF5File> persistent_file_;
+		std::string persistent_path_;
+
+		std::unique_ptr<HDF5File> session_owned_file_;
+		HDF5File *session_file_ = nullptr;
+		Sink *session_sink_ = nullptr;
+
+		bool session_field(const HDF5VTKDataNode<double> &node);
+
+		/// Only the first n_point_data_ (n_cell_data_) nodes are in use, clear keeps the nodes to reuse their storage
 		std::vector<HDF5VTKDataNode<double>> point_data_;
+		size_t n_point_data_;
 		std::string current_scalar_point_data_;
 		std::string current_vector_point_data_;
 
 		std::vector<HDF5VTKDataNode<double>> cell_data_;
+		size_t n_cell_data_;
 		std::string current_scalar_cell_data_;
 		std::string current_vector_cell_data_;
 
-		void write_data(h5pp::File &file);
-		void write_header(const int n_vertices, const int n_elements, const std::string &grp, h5pp::File &file);
-		void write_points(const Eigen::MatrixXd &points, h5pp::File &file);
-		void write_cells(const Eigen::MatrixXi &cells, const CellType ctype, const std::string &grp, h5pp::File &file);
-		void write_cells(const std::vector<CellElement> &cells, const std::string &grp, h5pp::File &file);
+		HDF5VTKDataNode<double> &next_node(const bool is_point);
+		void write_data(HDF5File &file, const std::string &grp);
+		void write_header(const int64_t n_vertices, const int64_t n_elements, const std::string &grp, HDF5File &file);
+		void write_points(const Eigen::MatrixXd &points, const std::string &grp, HDF5File &file);
+		void write_cells(const Eigen::MatrixXi &cells, const CellType ctype, const std::string &grp, HDF5File &file);
+		void write_cells(const std::vector<CellElement> &cells, const std::string &grp, HDF5File &file);
+		void write_cells(const PolyhedralCells &cells, const std::string &grp, HDF5File &file);
+
+		HDF5File *open_file(const std::string &path, std::unique_ptr<HDF5File> &file);
+		bool close_file(HDF5File &file);
 	};
 
 } // namespace paraviewo
@@ -0,0 +1,808 @@
+#include "MeshFilters.hpp"
+
+#include "NodeOrdering.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+namespace paraviewo
+{
+	namespace
+	{
+		using FaceTable = std::vector<std::vector<int>>;
+
+		// VTK node ordering, corners first then the edge (and face center) nodes of quadratic faces.
+		// 27 nodes hexahedra are Lagrange cells: the vertical edges are (0, 4), (1, 5), (3, 7), (2, 6).
+		const FaceTable TET_FACES = {{0, 1, 3}, {1, 2, 3}, {2, 0, 3}, {0, 2, 1}};
+		const FaceTable TET10_FACES = {{0, 1, 3, 4, 8, 7}, {1, 2, 3, 5, 9, 8}, {2, 0, 3, 6, 7, 9}, {0, 2, 1, 6, 5, 4}};
+
+		const FaceTable HEX_FACES = {{0, 4, 7, 3}, {1, 2, 6, 5}, {0, 1, 5, 4}, {3, 7, 6, 2}, {0, 3, 2, 1}, {4, 5, 6, 7}};
+		const FaceTable HEX27_FACES = {
+			{0, 4, 7, 3, 16, 15, 18, 11, 20},
+			{1, 2, 6, 5, 9, 19, 13, 17, 21},
+			{0, 1, 5, 4, 8, 17, 12, 16, 22},
+			{3, 7, 6, 2, 18, 14, 19, 10, 23},
+			{0, 3, 2, 1, 11, 10, 9, 8, 24},
+			{4, 5, 6, 7, 12, 13, 14, 15, 25}};
+
+		const FaceTable WEDGE_FACES = {{0, 1, 2}, {3, 5, 4}, {0, 3, 4, 1}, {1, 4, 5, 2}, {2, 5, 3, 0}};
+		const FaceTable WEDGE15_FACES = {{0, 1, 2, 6, 7, 8}, {3, 5, 4, 11, 10, 9}, {0, 3, 4, 1, 12, 9, 13, 6}, {1, 4, 5, 2, 13, 10, 14, 7}, {2, 5, 3, 0, 14, 11, 12, 8}};
+		const FaceTable WEDGE18_FACES = {{0, 1, 2, 6, 7, 8}, {3, 5, 4, 11, 10, 9}, {0, 3, 4, 1, 12, 9, 13, 6, 15}, {1, 4, 5, 2, 13, 10, 14, 7, 16}, {2, 5, 3, 0, 14, 11, 12, 8, 17}};
+
+		const FaceTable PYRAMID_FACES = {{0, 3, 2, 1}, {0, 1, 4}, {1, 2, 4}, {2, 3, 4}, {3, 0, 4}};
+		const FaceTable PYRAMID13_FACES = {{0, 3, 2, 1, 8, 7, 6, 5}, {0, 1, 4, 5, 10, 9}, {1, 2, 4, 6, 11, 10}, {2, 3, 4, 7, 12, 11}, {3, 0, 4, 8, 9, 12}};
+
+		/// Faces of a volume cell, nullptr for other cells
+		const FaceTable *cell_faces(const CellType ctype, const int n_vertices)
+		{
+			switch (ctype)
+			{
+			case CellType::Tetrahedron:
+				return n_vertices == 10 ? &TET10_FACES : &TET_FACES;
+			case CellType::Hexahedron:
+				return n_vertices == 27 ? &HEX27_FACES : &HEX_FACES;
+			case CellType::Wedge:
+				return n_vertices == 15 ? &WEDGE15_FACES : (n_vertices == 18 ? &WEDGE18_FACES : &WEDGE_FACES);
+			case CellType::Pyramid:
+				return n_vertices == 13 ? &PYRAMID13_FACES : &PYRAMID_FACES;
+			default:
+				return nullptr;
+			}
+		}
+
+		inline int face_corners(const std::vector<int> &face)
+		{
+			return face.size() == 3 || face.size() == 6 ? 3 : 4;
+		}
+
+		// Bits per axis of the space filling curve keys
+		const int CURVE_BITS = 21;
+
+		/// Skilling's transform of quantized coordinates to the transposed Hilbert index
+		void hilbert_transpose(uint32_t x[3])
+		{
+			const uint32_t m = uint32_t(1) << (CURVE_BITS - 1);
+
+			for (uint32_t q = m; q > 1; q >>= 1)
+			{
+				const uint32_t p = q - 1;
+				for (int i = 0; i < 3; ++i)
+				{
+					if (x[i] & q)
+						x[0] ^= p;
+					else
+					{
+						const uint32_t t = (x[0] ^ x[i]) & p;
+						x[0] ^= t;
+						x[i] ^= t;
+					}
+				}
+			}
+
+			for (int i = 1; i < 3; ++i)
+				x[i] ^= x[i - 1];
+			uint32_t t = 0;
+			for (uint32_t q = m; q > 1; q >>= 1)
+			{
+				if (x[2] & q)
+					t ^= q - 1;
+			}
+			for (int i = 0; i < 3; ++i)
+				x[i] ^= t;
+		}
+
+		/// Position of p along the curve, the box [min, min + extent] is mapped to the curve domain
+		uint64_t curve_key(const Eigen::Vector3d &p, const Eigen::Vector3d &min, const Eigen::Vector3d &extent, const bool hilbert)
+		{
+			const double scale = double((uint32_t(1) << CURVE_BITS) - 1);
+			uint32_t x[3];
+			for (int d = 0; d < 3; ++d)
+				x[d] = extent(d) > 0 ? uint32_t(std::min(scale, std::max(0., (p(d) - min(d)) / extent(d) * scale))) : 0;
+
+			if (hilbert)
+				hilbert_transpose(x);
+
+			uint64_t key = 0;
+			for (int b = CURVE_BITS - 1; b >= 0; --b)
+				for (int d = 0; d < 3; ++d)
+					key = (key << 1) | ((x[d] >> b) & 1);
+			return key;
+		}
+
+		/// Indices sorted by key, ties keep the input order
+		void sort_by_key(const std::vector<uint64_t> &keys, std::vector<int64_t> &order)
+		{
+			order.resize(keys.size());
+			for (int64_t i = 0; i < int64_t(order.size()); ++i)
+				order[i] = i;
+			std::stable_sort(order.begin(), order.end(), [&keys](const int64_t a, const int64_t b) { return keys[a] < keys[b]; });
+		}
+
+		inline Eigen::Vector3d point3(const Eigen::MatrixXd &points, const int64_t i)
+		{
+			Eigen::Vector3d p = Eigen::Vector3d::Zero();
+			for (int d = 0; d < std::min<int>(3, points.cols()); ++d)
+				p(d) = points(i, d);
+			return p;
+		}
+
+		void curve_order(const Eigen::MatrixXd &points, const CellsView &cells, const bool hilbert, const int n_threads, std::vector<int64_t> &point_order, std::vector<int64_t> &cell_order)
+		{
+			Eigen::Vector3d min = Eigen::Vector3d::Zero(), max = Eigen::Vector3d::Zero();
+			if (points.rows() > 0)
+			{
+				min = max = point3(points, 0);
+				for (int64_t i = 1; i < points.rows(); ++i)
+				{
+					min = min.cwiseMin(point3(points, i));
+					max = max.cwiseMax(point3(points, i));
+				}
+			}
+			const Eigen::Vector3d extent = max - min;
+
+			std::vector<uint64_t> keys(points.rows());
+			parallel_for(points.rows(), n_threads, [&](const int64_t begin, const int64_t end) {
+				for (int64_t i = begin; i < end; ++i)
+					keys[i] = curve_key(point3(points, i), min, extent, hilbert);
+			});
+			sort_by_key(keys, point_order);
+
+			keys.resize(cells.size());
+			parallel_for(cells.size(), n_threads, [&](const int64_t begin, const int64_t end) {
+				for (int64_t c = begin; c < end; ++c)
+				{
+					Eigen::Vector3d centroid = Eigen::Vector3d::Zero();
+					for (int j = 0; j < cells.n_vertices(c); ++j)
+						centroid += point3(points, cells.vertex(c, j));
+					centroid /= std::max(1, cells.n_vertices(c));
+					keys[c] = curve_key(centroid, min, extent, hilbert);
+				}
+			});
+			sort_by_key(keys, cell_order);
+		}
+
+		void rcm_order(const Eigen::MatrixXd &points, const CellsView &cells, std::vector<int64_t> &point_order, std::vector<int64_t> &cell_order)
+		{
+			const int64_t n_points = points.rows();
+			const int64_t n_cells = cells.size();
+
+			// Cells of every point, the neighbors of a point are the vertices of its cells
+			std::vector<int64_t> point_cells_offsets(n_points + 1, 0);
+			for (int64_t c = 0; c < n_cells; ++c)
+				for (int j = 0; j < cells.n_vertices(c); ++j)
+					++point_cells_offsets[cells.vertex(c, j) + 1];
+			for (int64_t i = 0; i < n_points; ++i)
+				point_cells_offsets[i + 1] += point_cells_offsets[i];
+
+			std::vector<int64_t> point_cells(point_cells_offsets.back());
+			std::vector<int64_t> fill(point_cells_offsets.begin(), point_cells_offsets.end() - 1);
+			for (int64_t c = 0; c < n_cells; ++c)
+				for (int j = 0; j < cells.n_vertices(c); ++j)
+					point_cells[fill[cells.vertex(c, j)]++] = c;
+
+			const auto degree = [&](const int64_t p) { return point_cells_offsets[p + 1] - point_cells_offsets[p]; };
+
+			std::vector<int64_t> by_degree(n_points);
+			for (int64_t i = 0; i < n_points; ++i)
+				by_degree[i] = i;
+			std::stable_sort(by_degree.begin(), by_degree.end(), [&](const int64_t a, const int64_t b) { return degree(a) < degree(b); });
+
+			std::vector<uint8_t> visited(n_points, 0);
+			std::vector<int64_t> neighbors;
+
+			const auto bfs = [&](const int64_t start, std::vector<int64_t> &order) {
+				const size_t first = order.size();
+				order.push_back(start);
+				visited[start] = 1;
+				for (size_t k = first; k < order.size(); ++k)
+				{
+					const int64_t p = order[k];
+					neighbors.clear();
+					for (int64_t i = point_cells_offsets[p]; i < point_cells_offsets[p + 1]; ++i)
+					{
+						const int64_t c = point_cells[i];
+						for (int j = 0; j < cells.n_vertices(c); ++j)
+						{
+							const int64_t q = cells.vertex(c, j);
+							if (!visited[q])
+							{
+								visited[q] = 1;
+								neighbors.push_back(q);
+							}
+						}
+					}
+					std::stable_sort(neighbors.begin(), neighbors.end(), [&](const int64_t a, const int64_t b) { return degree(a) < degree(b); });
+					order.insert(order.end(), neighbors.begin(), neighbors.end());
+				}
+			};
+
+			point_order.clear();
+			point_order.reserve(n_points);
+			std::vector<int64_t> component;
+			for (const int64_t start : by_degree)
+			{
+				if (visited[start])
+					continue;
+
+				// Pseudo-peripheral start: last point reached by a first traversal
+				component.clear();
+				bfs(start, component);
+				for (const int64_t p : component)
+					visited[p] = 0;
+				const int64_t far = component.back();
+
+				const size_t first = point_order.size();
+				bfs(far, point_order);
+				std::reverse(point_order.begin() + first, point_order.end());
+			}
+
+			// Cells in the order of their first point
+			std::vector<int64_t> new_index(n_points);
+			for (int64_t i = 0; i < n_points; ++i)
+				new_index[point_order[i]] = i;
+
+			std::vector<uint64_t> keys(n_cells);
+			for (int64_t c = 0; c < n_cells; ++c)
+			{
+				int64_t first = n_points;
+				for (int j = 0; j < cells.n_vertices(c); ++j)
+					first = std::min(first, new_index[cells.vertex(c, j)]);
+				keys[c] = first;
+			}
+			sort_by_key(keys, cell_order);
+		}
+
+		/// Sorted corners, -1 for the missing fourth corner of triangles
+		using FaceKey = std::array<int, 4>;
+
+		struct FaceKeyHash
+		{
+			size_t operator()(const FaceKey &key) const
+			{
+				// FNV-1a
+				uint64_t h = 1469598103934665603ULL;
+				for (const int v : key)
+				{
+					h ^= uint32_t(v);
+					h *= 1099511628211ULL;
+				}
+				return h;
+			}
+		};
+
+		/// Cell of the welding grid, the bits of the coordinates when welding identical points
+		using GridKey = std::array<int64_t, 3>;
+
+		struct GridKeyHash
+		{
+			size_t operator()(const GridKey &key) const
+			{
+				// FNV-1a
+				uint64_t h = 1469598103934665603ULL;
+				for (const int64_t v : key)
+				{
+					h ^= uint64_t(v);
+					h *= 1099511628211ULL;
+				}
+				return h;
+			}
+		};
+
+		GridKey grid_key(const Eigen::MatrixXd &points, const int64_t i, const double tolerance)
+		{
+			GridKey key = {{0, 0, 0}};
+			for (int d = 0; d < std::min<int>(3, points.cols()); ++d)
+			{
+				if (tolerance > 0)
+					key[d] = int64_t(std::floor(points(i, d) / tolerance));
+				else
+				{
+					// -0 and 0 are the same point
+					const double x = points(i, d) == 0 ? 0. : points(i, d);
+					std::memcpy(&key[d], &x, sizeof(x));
+				}
+			}
+			return key;
+		}
+	} // namespace
+
+	void FilteredMesh::add_cell(const CellType ctype, const int *vertices, const int n_vertices, const int64_t input_cell)
+	{
+		connectivity.insert(connectivity.end(), vertices, vertices + n_vertices);
+		offsets.push_back(connectivity.size());
+		types.push_back(ctype);
+		cell_map.push_back(input_cell);
+	}
+
+	void FilteredMesh::compact_points(const Eigen::MatrixXd &input_points, const int n_threads)
+	{
+		const int64_t n_input = input_points.rows();
+
+		std::unique_ptr<std::atomic<uint8_t>[]> used(new std::atomic<uint8_t>[n_input]);
+		parallel_for(n_input, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t i = begin; i < end; ++i)
+				used[i].store(0, std::memory_order_relaxed);
+		});
+		parallel_for(connectivity.size(), n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t i = begin; i < end; ++i)
+				used[connectivity[i]].store(1, std::memory_order_relaxed);
+		});
+
+		// New index of every used point, in input order
+		std::vector<int> new_index(n_input + 1);
+		const int n_used = parallel_exclusive_scan<int>(
+			n_input, n_threads, [&](const int64_t i) { return int(used[i].load(std::memory_order_relaxed)); }, new_index.data());
+
+		point_map.resize(n_used);
+		parallel_for(n_input, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t i = begin; i < end; ++i)
+			{
+				if (used[i].load(std::memory_order_relaxed))
+					point_map[new_index[i]] = i;
+			}
+		});
+
+		parallel_for(connectivity.size(), n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t i = begin; i < end; ++i)
+				connectivity[i] = new_index[connectivity[i]];
+		});
+
+		points.resize(point_map.size(), input_points.cols());
+		parallel_for(point_map.size(), n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t i = begin; i < end; ++i)
+				points.row(i) = input_points.row(point_map[i]);
+		});
+	}
+
+	void FilteredMesh::compose(const FilteredMesh &previous)
+	{
+		if (!previous.merged_offsets.empty())
+		{
+			// Every point gathers the welded points of its points in previous
+			std::vector<int64_t> offsets(1, 0), merged;
+			for (int64_t i = 0; i < int64_t(point_map.size()); ++i)
+			{
+				const int64_t *first = merged_offsets.empty() ? &point_map[i] : merged_points.data() + merged_offsets[i];
+				const int64_t *last = merged_offsets.empty() ? first + 1 : merged_points.data() + merged_offsets[i + 1];
+				for (const int64_t *q = first; q != last; ++q)
+					merged.insert(merged.end(), previous.merged_points.begin() + previous.merged_offsets[*q], previous.merged_points.begin() + previous.merged_offsets[*q + 1]);
+				offsets.push_back(merged.size());
+			}
+			merged_points.swap(merged);
+			merged_offsets.swap(offsets);
+		}
+		else
+		{
+			for (int64_t &p : merged_points)
+				p = previous.point_map[p];
+		}
+
+		for (int64_t &p : point_map)
+			p = previous.point_map[p];
+		for (int64_t &c : cell_map)
+			c = previous.cell_map[c];
+	}
+
+	bool FilteredMesh::uniform() const
+	{
+		for (int64_t i = 1; i < n_cells(); ++i)
+		{
+			if (types[i] != types[0] || offsets[i + 1] - offsets[i] != offsets[1] - offsets[0])
+				return false;
+		}
+		return true;
+	}
+
+	Eigen::MatrixXi FilteredMesh::cell_matrix() const
+	{
+		const int n_vertices = n_cells() > 0 ? offsets[1] - offsets[0] : 0;
+		Eigen::MatrixXi cells(n_cells(), n_vertices);
+		for (int64_t i = 0; i < n_cells(); ++i)
+			for (int j = 0; j < n_vertices; ++j)
+				cells(i, j) = connectivity[offsets[i] + j];
+		return cells;
+	}
+
+	std::vector<CellElement> FilteredMesh::cell_elements() const
+	{
+		std::vector<CellElement> cells(n_cells());
+		for (int64_t i = 0; i < n_cells(); ++i)
+		{
+			cells[i].vertices.assign(connectivity.begin() + offsets[i], connectivity.begin() + offsets[i + 1]);
+			cells[i].ctype = types[i];
+		}
+		return cells;
+	}
+
+	void weld_points(const Eigen::MatrixXd &points, const CellsView &cells, const double tolerance, const int n_threads, FilteredMesh &out)
+	{
+		const int64_t n_points = points.rows();
+		const int64_t n_cells = cells.size();
+
+		std::unique_ptr<std::atomic<uint8_t>[]> used(new std::atomic<uint8_t>[n_points]);
+		parallel_for(n_points, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t i = begin; i < end; ++i)
+				used[i].store(0, std::memory_order_relaxed);
+		});
+		parallel_for(n_cells, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t c = begin; c < end; ++c)
+				for (int j = 0; j < cells.n_vertices(c); ++j)
+					used[cells.vertex(c, j)].store(1, std::memory_order_relaxed);
+		});
+		const auto is_used = [&](const int64_t i) { return used[i].load(std::memory_order_relaxed) != 0; };
+
+		// Point every used point is welded to, never after it
+		std::vector<int64_t> target(n_points);
+		for (int64_t i = 0; i < n_points; ++i)
+			target[i] = i;
+
+		if (tolerance >= 0)
+		{
+			std::vector<GridKey> keys(n_points);
+			std::vector<uint64_t> hashes(n_points);
+			parallel_for(n_points, n_threads, [&](const int64_t begin, const int64_t end) {
+				const GridKeyHash hash;
+				for (int64_t i = begin; i < end; ++i)
+				{
+					keys[i] = grid_key(points, i, tolerance);
+					hashes[i] = hash(keys[i]);
+				}
+			});
+
+			// Every thread builds the grid of its own hash partition, the points of a cell are in increasing order
+			using Grid = std::unordered_map<GridKey, std::vector<int64_t>, GridKeyHash>;
+			const int n_parts = std::max(1, n_threads);
+			std::vector<Grid> grids(n_parts);
+			parallel_for(
+				n_parts, n_threads, [&](const int64_t begin, const int64_t end) {
+					for (int64_t part = begin; part < end; ++part)
+					{
+						for (int64_t i = 0; i < n_points; ++i)
+						{
+							if (is_used(i) && int64_t(hashes[i] % n_parts) == part)
+								grids[part][keys[i]].push_back(i);
+						}
+					}
+				},
+				1);
+
+			// First point within tolerance, in the cell of the point and (with a tolerance) the neighboring cells
+			const double tolerance2 = tolerance * tolerance;
+			const int reach = tolerance > 0 ? 1 : 0;
+			parallel_for(n_points, n_threads, [&](const int64_t begin, const int64_t end) {
+				const GridKeyHash hash;
+				for (int64_t i = begin; i < end; ++i)
+				{
+					if (!is_used(i))
+						continue;
+
+					for (int dx = -reach; dx <= reach; ++dx)
+						for (int dy = -reach; dy <= reach; ++dy)
+							for (int dz = -reach; dz <= reach; ++dz)
+							{
+								const GridKey key = {{keys[i][0] + dx, keys[i][1] + dy, keys[i][2] + dz}};
+								const Grid &grid = grids[hash(key) % n_parts];
+								const auto it = grid.find(key);
+								if (it == grid.end())
+									continue;
+
+								for (const int64_t j : it->second)
+								{
+									if (j >= target[i])
+										break;
+									if ((points.row(i) - points.row(j)).squaredNorm() <= tolerance2)
+									{
+										target[i] = j;
+										break;
+									}
+								}
+							}
+				}
+			});
+
+			// Chains end at a point welded to itself, targets come first
+			for (int64_t i = 0; i < n_points; ++i)
+				target[i] = target[target[i]];
+		}
+
+		// Kept points: the used points welded to themselves
+		std::vector<int> new_index(n_points + 1);
+		const int n_kept = parallel_exclusive_scan<int>(
+			n_points, n_threads, [&](const int64_t i) { return int(is_used(i) && target[i] == i); }, new_index.data());
+
+		out = FilteredMesh();
+		out.point_map.resize(n_kept);
+		parallel_for(n_points, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t i = begin; i < end; ++i)
+			{
+				if (is_used(i) && target[i] == i)
+					out.point_map[new_index[i]] = i;
+			}
+		});
+
+		out.points.resize(n_kept, points.cols());
+		parallel_for(n_kept, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t i = begin; i < end; ++i)
+				out.points.row(i) = points.row(out.point_map[i]);
+		});
+
+		// Welded points of every kept point, in increasing order
+		out.merged_offsets.assign(n_kept + 1, 0);
+		for (int64_t i = 0; i < n_points; ++i)
+		{
+			if (is_used(i))
+				++out.merged_offsets[new_index[target[i]] + 1];
+		}
+		for (int64_t i = 0; i < n_kept; ++i)
+			out.merged_offsets[i + 1] += out.merged_offsets[i];
+		out.merged_points.resize(out.merged_offsets.back());
+		std::vector<int64_t> fill(out.merged_offsets.begin(), out.merged_offsets.end() - 1);
+		for (int64_t i = 0; i < n_points; ++i)
+		{
+			if (is_used(i))
+				out.merged_points[fill[new_index[target[i]]]++] = i;
+		}
+
+		// Same cells, renumbered
+		out.offsets.resize(n_cells + 1);
+		parallel_exclusive_scan<int64_t>(
+			n_cells, n_threads, [&](const int64_t c) { return int64_t(cells.n_vertices(c)); }, out.offsets.data());
+		out.connectivity.resize(out.offsets.back());
+		out.types.resize(n_cells);
+		out.cell_map.resize(n_cells);
+		parallel_for(n_cells, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t c = begin; c < end; ++c)
+			{
+				out.types[c] = cells.type(c);
+				out.cell_map[c] = c;
+				for (int j = 0; j < cells.n_vertices(c); ++j)
+					out.connectivity[out.offsets[c] + j] = new_index[target[cells.vertex(c, j)]];
+			}
+		});
+	}
+
+	void extract_boundary(const Eigen::MatrixXd &points, const CellsView &cells, const int n_threads, FilteredMesh &out)
+	{
+		const int64_t n_cells = cells.size();
+
+		std::vector<int64_t> face_offsets(n_cells + 1, 0);
+		for (int64_t c = 0; c < n_cells; ++c)
+		{
+			const FaceTable *faces = cell_faces(cells.type(c), cells.n_vertices(c));
+			face_offsets[c + 1] = face_offsets[c] + (faces ? faces->size() : 0);
+		}
+		const int64_t n_faces = face_offsets.back();
+
+		std::vector<FaceKey> keys(n_faces);
+		std::vector<uint64_t> hashes(n_faces);
+		parallel_for(n_cells, n_threads, [&](const int64_t begin, const int64_t end) {
+			const FaceKeyHash hash;
+			for (int64_t c = begin; c < end; ++c)
+			{
+				const FaceTable *faces = cell_faces(cells.type(c), cells.n_vertices(c));
+				if (!faces)
+					continue;
+
+				for (size_t f = 0; f < faces->size(); ++f)
+				{
+					const std::vector<int> &face = (*faces)[f];
+					FaceKey &key = keys[face_offsets[c] + f];
+					key.fill(-1);
+					for (int k = 0; k < face_corners(face); ++k)
+						key[k] = cells.vertex(c, face[k]);
+					std::sort(key.begin(), key.end());
+					hashes[face_offsets[c] + f] = hash(key);
+				}
+			}
+		});
+
+		// Every thread counts the faces of its own hash partition, a face is on the boundary if it appears once
+		const int n_parts = std::max(1, n_threads);
+		std::vector<uint8_t> boundary(n_faces, 0);
+		parallel_for(
+			n_parts, n_threads, [&](const int64_t begin, const int64_t end) {
+				for (int64_t part = begin; part < end; ++part)
+				{
+					std::unordered_map<FaceKey, int, FaceKeyHash> counts;
+					counts.reserve(n_faces / n_parts + 1);
+					for (int64_t f = 0; f < n_faces; ++f)
+					{
+						if (int64_t(hashes[f] % n_parts) == part)
+							++counts[keys[f]];
+					}
+					for (int64_t f = 0; f < n_faces; ++f)
+					{
+						if (int64_t(hashes[f] % n_parts) == part)
+							boundary[f] = counts[keys[f]] == 1;
+					}
+				}
+			},
+			1);
+
+		out = FilteredMesh();
+		std::vector<int> vertices;
+		for (int64_t c = 0; c < n_cells; ++c)
+		{
+			const FaceTable *faces = cell_faces(cells.type(c), cells.n_vertices(c));
+			if (!faces)
+			{
+				vertices.resize(cells.n_vertices(c));
+				for (int j = 0; j < cells.n_vertices(c); ++j)
+					vertices[j] = cells.vertex(c, j);
+				out.add_cell(cells.type(c), vertices.data(), vertices.size(), c);
+				continue;
+			}
+
+			for (size_t f = 0; f < faces->size(); ++f)
+			{
+				if (!boundary[face_offsets[c] + f])
+					continue;
+
+				const std::vector<int> &face = (*faces)[f];
+				vertices.resize(face.size());
+				for (size_t k = 0; k < face.size(); ++k)
+					vertices[k] = cells.vertex(c, face[k]);
+				out.add_cell(face_corners(face) == 3 ? CellType::Triangle : CellType::Quadrilateral, vertices.data(), vertices.size(), c);
+			}
+		}
+
+		out.compact_points(points, n_threads);
+	}
+
+	void select_cells(const Eigen::MatrixXd &points, const CellsView &cells, const std::function<bool(const int64_t cell)> &selected, const int n_threads, FilteredMesh &out)
+	{
+		const int64_t n_cells = cells.size();
+
+		std::vector<uint8_t> flags(n_cells);
+		parallel_for(n_cells, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t c = begin; c < end; ++c)
+				flags[c] = selected(c);
+		});
+
+		// Position of every selected cell and of its vertices in the output
+		std::vector<int64_t> cell_pos(n_cells + 1);
+		std::vector<int64_t> vertex_pos(n_cells + 1);
+		const int64_t n_selected = parallel_exclusive_scan<int64_t>(
+			n_cells, n_threads, [&](const int64_t c) { return int64_t(flags[c]); }, cell_pos.data());
+		const int64_t n_connectivity = parallel_exclusive_scan<int64_t>(
+			n_cells, n_threads, [&](const int64_t c) { return flags[c] ? int64_t(cells.n_vertices(c)) : int64_t(0); }, vertex_pos.data());
+
+		out = FilteredMesh();
+		out.connectivity.resize(n_connectivity);
+		out.offsets.resize(n_selected + 1);
+		out.types.resize(n_selected);
+		out.cell_map.resize(n_selected);
+
+		parallel_for(n_cells, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t c = begin; c < end; ++c)
+			{
+				if (!flags[c])
+					continue;
+
+				const int64_t k = cell_pos[c];
+				out.types[k] = cells.type(c);
+				out.cell_map[k] = c;
+				out.offsets[k + 1] = vertex_pos[c] + cells.n_vertices(c);
+				for (int j = 0; j < cells.n_vertices(c); ++j)
+					out.connectivity[vertex_pos[c] + j] = cells.vertex(c, j);
+			}
+		});
+
+		out.compact_points(points, n_threads);
+	}
+
+	std::function<bool(const int64_t cell)> box_selector(const Eigen::MatrixXd &points, const CellsView &cells, const Eigen::Vector3d &min, const Eigen::Vector3d &max)
+	{
+		return [&points, cells, min, max](const int64_t c) {
+			const int n_vertices = cells.n_vertices(c);
+			if (n_vertices == 0)
+				return false;
+
+			for (int d = 0; d < std::min<int>(3, points.cols()); ++d)
+			{
+				double centroid = 0;
+				for (int j = 0; j < n_vertices; ++j)
+					centroid += points(cells.vertex(c, j), d);
+				centroid /= n_vertices;
+
+				if (centroid < min(d) || centroid > max(d))
+					return false;
+			}
+			return true;
+		};
+	}
+
+	void compute_reordering(const Eigen::MatrixXd &points, const CellsView &cells, const Reordering method, const int n_threads, std::vector<int64_t> &point_order, std::vector<int64_t> &cell_order)
+	{
+		switch (method)
+		{
+		case Reordering::Morton:
+			curve_order(points, cells, false, n_threads, point_order, cell_order);
+			break;
+		case Reordering::Hilbert:
+			curve_order(points, cells, true, n_threads, point_order, cell_order);
+			break;
+		case Reordering::RCM:
+			rcm_order(points, cells, point_order, cell_order);
+			break;
+		default:
+			point_order.resize(points.rows());
+			for (int64_t i = 0; i < points.rows(); ++i)
+				point_order[i] = i;
+			cell_order.resize(cells.size());
+			for (int64_t c = 0; c < cells.size(); ++c)
+				cell_order[c] = c;
+		}
+	}
+
+	void reorder(const Eigen::MatrixXd &points, const CellsView &cells, const std::vector<int64_t> &point_order, const std::vector<int64_t> &cell_order, const int n_threads, FilteredMesh &out)
+	{
+		const int64_t n_points = points.rows();
+		const int64_t n_cells = cells.size();
+		assert(int64_t(point_order.size()) == n_points && int64_t(cell_order.size()) == n_cells);
+
+		std::vector<int> new_index(n_points);
+		parallel_for(n_points, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t i = begin; i < end; ++i)
+				new_index[point_order[i]] = i;
+		});
+
+		out = FilteredMesh();
+		out.point_map = point_order;
+		out.cell_map = cell_order;
+
+		out.points.resize(n_points, points.cols());
+		parallel_for(n_points, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t i = begin; i < end; ++i)
+				out.points.row(i) = points.row(point_order[i]);
+		});
+
+		out.offsets.resize(n_cells + 1);
+		parallel_exclusive_scan<int64_t>(
+			n_cells, n_threads, [&](const int64_t c) { return int64_t(cells.n_vertices(cell_order[c])); }, out.offsets.data());
+
+		out.connectivity.resize(out.offsets.back());
+		out.types.resize(n_cells);
+		parallel_for(n_cells, n_threads, [&](const int64_t begin, const int64_t end) {
+			for (int64_t c = begin; c < end; ++c)
+			{
+				const int64_t input = cell_order[c];
+				out.types[c] = cells.type(input);
+				for (int j = 0; j < cells.n_vertices(input); ++j)
+					out.connectivity[out.offsets[c] + j] = new_index[cells.vertex(input, j)];
+			}
+		});
+	}
+
+	void permute_nodes(const CellsView &cells, const NodeOrdering ordering, const int n_threads, FilteredMesh &out)
+	{
+		const int64_t n_cells = cells.size();
+
+		out = FilteredMesh();
+		out.offsets.resize(n_cells + 1);
+		parallel_exclusive_scan<int64_t>(
+			n_cells, n_threads, [&](const int64_t c) { return int64_t(cells.n_vertices(c)); }, out.offsets.data());
+
+		// Gather through the permutation tables, each thread caches its own lookups
+		out.connectivity.resize(out.offsets.back());
+		out.types.resize(n_cells);
+		parallel_for(n_cells, n_threads, [&](const int64_t begin, const int64_t end) {
+			NodePermutations permutations(ordering);
+			for (int64_t c = begin; c < end; ++c)
+			{
+				const int n_vertices = cells.n_vertices(c);
+				const int *perm = permutations.get(cells.type(c), n_vertices);
+				out.types[c] = cells.type(c);
+				for (int j = 0; j < n_vertices; ++j)
+					out.connectivity[out.offsets[c] + j] = cells.vertex(c, perm ? perm[j] : j);
+			}
+		});
+	}
+} // namespace paraviewo
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "ParaviewWriter.hpp"
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Mesh produced by a filter, with the maps from its points and cells to the rows of the input
+	class FilteredMesh
+	{
+	public:
+		Eigen::MatrixXd points;
+
+		/// Cells in compressed rows: the vertices of cell i are connectivity[offsets[i]] ... connectivity[offsets[i + 1] - 1]
+		std::vector<int> connectivity;
+		std::vector<int64_t> offsets = {0};
+		std::vector<CellType> types;
+
+		/// Input point (resp. cell) of every output point (resp. cell)
+		std::vector<int64_t> point_map;
+		std::vector<int64_t> cell_map;
+
+		/// Input points welded into every output point in compressed rows (see weld_points), empty without welding
+		std::vector<int64_t> merged_points;
+		std::vector<int64_t> merged_offsets;
+
+		inline int64_t n_cells() const { return types.size(); }
+
+		void add_cell(const CellType ctype, const int *vertices, const int n_vertices, const int64_t input_cell);
+
+		/// Keeps only the points referenced by the cells (in their input order), connectivity is renumbered.
+		/// The connectivity is expected to refer to the input points.
+		void compact_points(const Eigen::MatrixXd &input_points, const int n_threads);
+
+		/// Makes the maps refer to the input of previous, when this mesh was produced from previous
+		void compose(const FilteredMesh &previous);
+
+		/// True if all cells have the same type and number of vertices, they can then be written as a matrix
+		bool uniform() const;
+		Eigen::MatrixXi cell_matrix() const;
+		std::vector<CellElement> cell_elements() const;
+	};
+
+	/// Read-only access to the cells passed to write_mesh (a matrix of cells of one type or a list of elements),
+	/// or to the cells of a FilteredMesh
+	class CellsView
+	{
+	public:
+		CellsView(const Eigen::MatrixXi &cells, const CellType ctype)
+			: matrix_(&cells), ctype_(ctype), elements_(nullptr), filtered_(nullptr)
+		{
+		}
+
+		CellsView(const std::vector<CellElement> &cells)
+			: matrix_(nullptr), ctype_(CellType::Vertex), elements_(&cells), filtered_(nullptr)
+		{
+		}
+
+		CellsView(const FilteredMesh &mesh)
+			: matrix_(nullptr), ctype_(CellType::Vertex), elements_(nullptr), filtered_(&mesh)
+		{
+		}
+
+		inline int64_t size() const
+		{
+			if (matrix_)
+				return matrix_->rows();
+			return elements_ ? elements_->size() : filtered_->n_cells();
+		}
+
+		inline int n_vertices(const int64_t c) const
+		{
+			if (matrix_)
+				return matrix_->cols();
+			return elements_ ? (*elements_)[c].vertices.size() : filtered_->offsets[c + 1] - filtered_->offsets[c];
+		}
+
+		inline int vertex(const int64_t c, const int j) const
+		{
+			if (matrix_)
+				return (*matrix_)(c, j);
+			return elements_ ? (*elements_)[c].vertices[j] : filtered_->connectivity[filtered_->offsets[c] + j];
+		}
+
+		inline CellType type(const int64_t c) const
+		{
+			if (matrix_)
+				return ctype_;
+			return elements_ ? (*elements_)[c].ctype : filtered_->types[c];
+		}
+
+	private:
+		const Eigen::MatrixXi *matrix_;
+		CellType ctype_;
+		const std::vector<CellElement> *elements_;
+		const FilteredMesh *filtered_;
+	};
+
+	/// Faces of the volume cells (tetrahedra, hexahedra, wedges and pyramids) not shared with another cell, outward oriented
+	/// for positively oriented cells. Quadratic cells (tet10, hex27, wedge15/18, pyramid13) give quadratic faces, other
+	/// high order cells give linear faces. Surface and line cells are kept as they are. Faces are matched with a hash table
+	/// partitioned over n_threads threads; every face inherits the cell fields of its cell.
+	void extract_boundary(const Eigen::MatrixXd &points, const CellsView &cells, const int n_threads, FilteredMesh &out);
+
+	/// Cells for which selected(cell) is true (it is called concurrently), with the points they reference.
+	/// The selection is compacted with parallel prefix sums.
+	void select_cells(const Eigen::MatrixXd &points, const CellsView &cells, const std::function<bool(const int64_t cell)> &selected, const int n_threads, FilteredMesh &out);
+
+	/// True for the cells whose centroid is in the box [min, max]
+	std::function<bool(const int64_t cell)> box_selector(const Eigen::MatrixXd &points, const CellsView &cells, const Eigen::Vector3d &min, const Eigen::Vector3d &max);
+
+	/// Value of a point field at a welded point
+	enum class PointMerge
+	{
+		/// Average of the welded points
+		Average,
+		/// Value of the first (lowest index) welded point
+		First
+	};
+
+	/// Welds the points of the cells closer than tolerance (0 welds identical coordinates only) and drops the points
+	/// no cell uses, a negative tolerance only drops them. Every point goes to the first point within tolerance, found
+	/// with a spatial hash grid partitioned over n_threads threads; chains of close points are welded together.
+	/// Cells keep their order, out.merged_points lists the welded points for the averaging of the fields.
+	void weld_points(const Eigen::MatrixXd &points, const CellsView &cells, const double tolerance, const int n_threads, FilteredMesh &out);
+
+	enum class Reordering
+	{
+		None,
+		/// Z-order curve of the points and of the cell centroids
+		Morton,
+		/// Hilbert curve of the points and of the cell centroids, better locality than Morton
+		Hilbert,
+		/// Reverse Cuthill-McKee on the point graph, cells follow their first point
+		RCM
+	};
+
+	/// Permutations improving the locality of the points and cells: point_order[i] (resp. cell_order[i]) is the
+	/// input point (resp. cell) that goes to position i
+	void compute_reordering(const Eigen::MatrixXd &points, const CellsView &cells, const Reordering method, const int n_threads, std::vector<int64_t> &point_order, std::vector<int64_t> &cell_order);
+
+	/// Permutes the points, the cells and the connectivity with the orders of compute_reordering
+	void reorder(const Eigen::MatrixXd &points, const CellsView &cells, const std::vector<int64_t> &point_order, const std::vector<int64_t> &cell_order, const int n_threads, FilteredMesh &out);
+
+	/// Cells with their nodes converted from ordering to the VTK order (see NodeOrdering.hpp), for the filters that
+	/// expect it. Points and cells keep their indices: out has no points and no maps, it goes with the input points.
+	void permute_nodes(const CellsView &cells, const NodeOrdering ordering, const int n_threads, FilteredMesh &out);
+} // namespace paraviewo
@@ -0,0 +1,92 @@
+#include "NodeOrdering.hpp"
+
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+namespace paraviewo
+{
+	namespace
+	{
+		using Key = std::tuple<NodeOrdering, CellType, int>;
+
+		class Registry
+		{
+		public:
+			Registry()
+			{
+				// Gmsh quadratic cells, the triangles and quadrilaterals already match
+				add(NodeOrdering::Gmsh, CellType::Tetrahedron, {0, 1, 2, 3, 4, 5, 6, 7, 9, 8});
+				add(NodeOrdering::Gmsh, CellType::Hexahedron, {0, 1, 2, 3, 4, 5, 6, 7, 8, 11, 13, 9, 16, 18, 19, 17, 10, 12, 15, 14, 22, 23, 21, 24, 20, 25, 26});
+				add(NodeOrdering::Gmsh, CellType::Wedge, {0, 1, 2, 3, 4, 5, 6, 9, 7, 12, 14, 13, 8, 10, 11});
+				add(NodeOrdering::Gmsh, CellType::Wedge, {0, 1, 2, 3, 4, 5, 6, 9, 7, 12, 14, 13, 8, 10, 11, 15, 17, 16});
+				add(NodeOrdering::Gmsh, CellType::Pyramid, {0, 1, 2, 3, 4, 5, 8, 10, 6, 7, 9, 11, 12});
+			}
+
+			std::shared_ptr<const std::vector<int>> find(const Key &key)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				const auto it = tables_.find(key);
+				return it == tables_.end() ? nullptr : it->second;
+			}
+
+			void add(const NodeOrdering ordering, const CellType ctype, const std::vector<int> &perm)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				tables_[Key(ordering, ctype, perm.size())] = std::make_shared<const std::vector<int>>(perm);
+			}
+
+		private:
+			std::mutex mutex_;
+			std::map<Key, std::shared_ptr<const std::vector<int>>> tables_;
+		};
+
+		Registry &registry()
+		{
+			static Registry registry;
+			return registry;
+		}
+	} // namespace
+
+	std::shared_ptr<const std::vector<int>> node_permutation(const NodeOrdering ordering, const CellType ctype, const int n_nodes)
+	{
+		if (ordering == NodeOrdering::VTK)
+			return nullptr;
+		return registry().find(Key(ordering, ctype, n_nodes));
+	}
+
+	void register_node_permutation(const NodeOrdering ordering, const CellType ctype, const int n_nodes, const std::vector<int> &perm)
+	{
+		if (ordering == NodeOrdering::VTK)
+			throw std::invalid_argument("The VTK ordering has no permutation");
+
+		std::vector<bool> seen(n_nodes, false);
+		bool valid = int(perm.size()) == n_nodes;
+		for (size_t j = 0; valid && j < perm.size(); ++j)
+		{
+			valid = perm[j] >= 0 && perm[j] < n_nodes && !seen[perm[j]];
+			if (valid)
+				seen[perm[j]] = true;
+		}
+		if (!valid)
+			throw std::invalid_argument("Invalid node permutation");
+
+		registry().add(ordering, ctype, perm);
+	}
+
+	const int *NodePermutations::get(const CellType ctype, const int n_nodes)
+	{
+		if (ordering_ == NodeOrdering::VTK)
+			return nullptr;
+
+		for (const Entry &e : entries_)
+		{
+			if (e.ctype == ctype && e.n_nodes == n_nodes)
+				return e.perm ? e.perm->data() : nullptr;
+		}
+
+		entries_.push_back({ctype, n_nodes, node_permutation(ordering_, ctype, n_nodes)});
+		return entries_.back().perm ? entries_.back().perm->data() : nullptr;
+	}
+} // namespace paraviewo
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ParaviewWriter.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Permutation converting the nodes of the cells of type ctype with n_nodes nodes from ordering to the VTK order:
+	/// node j of the VTK cell is node perm[j] of the input cell. nullptr when the orders are the same.
+	/// Tables are built once and shared, lookups are thread safe.
+	std::shared_ptr<const std::vector<int>> node_permutation(const NodeOrdering ordering, const CellType ctype, const int n_nodes);
+
+	/// Adds (or replaces) the permutation of a cell type and number of nodes, e.g. for higher orders or the ordering
+	/// of another code (NodeOrdering::Custom). Throws std::invalid_argument if perm is not a permutation of n_nodes nodes.
+	void register_node_permutation(const NodeOrdering ordering, const CellType ctype, const int n_nodes, const std::vector<int> &perm);
+
+	/// Permutations used while writing one mesh, looked up once per cell type and number of nodes
+	class NodePermutations
+	{
+	public:
+		NodePermutations(const NodeOrdering ordering)
+			: ordering_(ordering)
+		{
+		}
+
+		/// nullptr when the cells are already in the VTK order
+		const int *get(const CellType ctype, const int n_nodes);
+
+	private:
+		struct Entry
+		{
+			CellType ctype;
+			int n_nodes;
+			std::shared_ptr<const std::vector<int>> perm;
+		};
+
+		NodeOrdering ordering_;
+		std::vector<Entry> entries_;
+	};
+} // namespace paraviewo
@@ -0,0 +1,85 @@
+#include "OutputGovernor.hpp"
+
+#include "PVDWriter.hpp"
+
+#include <chrono>
+
+namespace paraviewo
+{
+	OutputGovernor::OutputGovernor(const double budget)
+		: budget_(budget), output_(0), n_levels_(0), level_(0), cost_(1, -1), dropped_(0)
+	{
+		set_clock([]() { return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count(); });
+	}
+
+	void OutputGovernor::set_clock(const Clock &clock)
+	{
+		clock_ = clock;
+		start_ = clock_();
+	}
+
+	void OutputGovernor::set_levels(const int n_levels, const std::function<void(const int level)> &apply)
+	{
+		n_levels_ = std::max(0, n_levels);
+		apply_ = apply;
+		cost_.assign(n_levels_ + 1, -1);
+
+		level_ = -1;
+		change_level(0);
+	}
+
+	void OutputGovernor::change_level(const int level)
+	{
+		if (level == level_)
+			return;
+
+		level_ = level;
+		if (apply_)
+			apply_(level_);
+	}
+
+	bool OutputGovernor::fits(const int level, const double elapsed) const
+	{
+		// Unknown costs are measured by writing
+		const double cost = cost_[level];
+		return cost < 0 || output_ + cost <= budget_ * (elapsed + cost);
+	}
+
+	bool OutputGovernor::write_step(const double time, const std::function<std::string()> &write)
+	{
+		const double now = clock_();
+		const double elapsed = now - start_;
+
+		// Back to a better level as soon as it fits, otherwise cheaper levels until the write fits
+		while (level_ > 0 && fits(level_ - 1, elapsed))
+			change_level(level_ - 1);
+		while (level_ < n_levels_ && !fits(level_, elapsed))
+			change_level(level_ + 1);
+
+		if (!fits(level_, elapsed))
+		{
+			++dropped_;
+			return false;
+		}
+
+		const std::string file = write();
+		const double cost = clock_() - now;
+
+		output_ += cost;
+		double &average = cost_[level_];
+		average = average < 0 ? cost : (average + cost) / 2;
+
+		if (file.empty())
+			return false;
+
+		times_.push_back(time);
+		files_.push_back(file);
+		levels_.push_back(level_);
+		return true;
+	}
+
+	void OutputGovernor::save_pvd(const std::string &path) const
+	{
+		PVDWriter::save_pvd(path, times_, files_);
+	}
+} // namespace paraviewo
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Keeps the output of a time series within a fraction of the wall time: every step is written only if the
+	/// estimated cost of the write fits in the budget, otherwise the output switches to a cheaper level (if any)
+	/// or the step is dropped. The written steps are recorded for the PVD collection.
+	///
+	/// governor.set_levels(1, [&](int level) { filtered.set_boundary_only(level >= 1); });
+	/// for (...)
+	/// {
+	///     solve();
+	///     governor.write_step(t, [&]() { filtered.add_field("u", u); return filtered.write_mesh(path, v, f, ctype) ? path : ""; });
+	/// }
+	/// governor.save_pvd("sim.pvd");
+	class OutputGovernor
+	{
+	public:
+		/// Current time in seconds
+		using Clock = std::function<double()>;
+
+		/// Output may take at most budget (e.g., 0.05) of the wall time elapsed since the construction
+		OutputGovernor(const double budget);
+
+		/// Cheaper output levels: apply(level) configures the writers for a level in [0, n_levels], 0 being the
+		/// full output and n_levels the cheapest (e.g., boundary only, reduced precision, faster compression).
+		/// apply(0) is called immediately.
+		void set_levels(const int n_levels, const std::function<void(const int level)> &apply);
+
+		/// Calls write if the step fits in the budget and measures it, write returns the written file (empty on failure).
+		/// Returns true if the step was written.
+		bool write_step(const double time, const std::function<std::string()> &write);
+
+		/// PVD collection of the written steps
+		void save_pvd(const std::string &path) const;
+
+		/// Time source, steady clock by default, the elapsed time restarts
+		void set_clock(const Clock &clock);
+
+		inline int level() const { return level_; }
+		inline double output_seconds() const { return output_; }
+		inline double elapsed_seconds() const { return clock_() - start_; }
+
+		/// Written steps
+		inline const std::vector<double> &times() const { return times_; }
+		inline const std::vector<std::string> &files() const { return files_; }
+		inline const std::vector<int> &levels() const { return levels_; }
+		inline int dropped_steps() const { return dropped_; }
+
+	private:
+		double budget_;
+		Clock clock_;
+		double start_;
+		double output_;
+
+		int n_levels_;
+		std::function<void(const int level)> apply_;
+		int level_;
+		/// Moving average of the cost of a write at each level, negative if unknown
+		std::vector<double> cost_;
+
+		std::vector<double> times_;
+		std::vector<std::string> files_;
+		std::vector<int> levels_;
+		int dropped_;
+
+		bool fits(const int level, const double elapsed) const;
+		void change_level(const int level);
+	};
+} // namespace paraviewo
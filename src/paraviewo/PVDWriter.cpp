@@ -8,6 +8,22 @@ namespace paraviewo
 		const std::string &name,
 		const std::function<std::string(int)> &vtu_names,
 		int time_steps, double t0, double dt, int skip_frame)
+	{
+		std::vector<double> times;
+		std::vector<std::string> files;
+		for (int i = 0; i <= time_steps; i += skip_frame)
+		{
+			times.push_back(t0 + i * dt);
+			files.push_back(vtu_names(i));
+		}
+
+		save_pvd(name, times, files);
+	}
+
+	void PVDWriter::save_pvd(
+		const std::string &name,
+		const std::vector<double> &times,
+		const std::vector<std::string> &files)
 	{
 		// https://www.paraview.org/Wiki/ParaView/Data_formats#PVD_File_Format
 
@@ -23,15 +39,15 @@ namespace paraviewo
 
 		tinyxml2::XMLElement *collection = root->InsertNewChildElement("Collection");
 
-		for (int i = 0; i <= time_steps; i += skip_frame)
+		for (size_t i = 0; i < times.size() && i < files.size(); ++i)
 		{
 			tinyxml2::XMLElement *dataset = collection->InsertNewChildElement("DataSet");
-			dataset->SetAttribute("timestep", std::to_string(t0 + i * dt).c_str());
+			dataset->SetAttribute("timestep", std::to_string(times[i]).c_str());
 			dataset->SetAttribute("group", "");
 			dataset->SetAttribute("part", "0");
-			dataset->SetAttribute("file", vtu_names(i).c_str());
+			dataset->SetAttribute("file", files[i].c_str());
 		}
 
 		pvd.SaveFile(name.c_str());
 	}
-} // namespace paraviewo
\ No newline at end of file
+} // namespace paraviewo
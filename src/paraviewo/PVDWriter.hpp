@@ -2,6 +2,7 @@
 
 #include <string>
 #include <functional>
+#include <vector>
 
 namespace paraviewo
 {
@@ -12,5 +13,11 @@ namespace paraviewo
 			const std::string &name,
 			const std::function<std::string(int)> &vtu_names,
 			int time_steps, double t0, double dt, int skip_frame);
+
+		/// Collection of the given files, files[i] is the step at times[i]
+		static void save_pvd(
+			const std::string &name,
+			const std::vector<double> &times,
+			const std::vector<std::string> &files);
 	};
 } // namespace paraviewo
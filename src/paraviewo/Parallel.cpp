@@ -0,0 +1,115 @@
+#include "Parallel.hpp"
+
+#include <exception>
+
+namespace paraviewo
+{
+	ThreadPool &ThreadPool::instance()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+	ThreadPool::ThreadPool()
+		: stop_(false)
+	{
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		changed_.notify_all();
+
+		for (auto &worker : workers_)
+			worker.join();
+	}
+
+	void ThreadPool::work()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (true)
+		{
+			changed_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+			if (queue_.empty())
+				return;
+
+			std::function<void()> task = std::move(queue_.front());
+			queue_.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+		}
+	}
+
+	void ThreadPool::run(const int64_t n_tasks, const std::function<void(int64_t)> &task)
+	{
+		int64_t remaining = n_tasks;
+		std::exception_ptr error;
+
+		// Called under the lock by the thread finishing a task
+		const auto finish = [&](const std::exception_ptr &e) {
+			if (e && !error)
+				error = e;
+			if (--remaining == 0)
+				changed_.notify_all();
+		};
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			while (int64_t(workers_.size()) < n_tasks - 1)
+				workers_.emplace_back([this]() { work(); });
+
+			for (int64_t t = 1; t < n_tasks; ++t)
+			{
+				queue_.push_back([&task, &finish, this, t]() {
+					std::exception_ptr e;
+					try
+					{
+						task(t);
+					}
+					catch (...)
+					{
+						e = std::current_exception();
+					}
+					std::lock_guard<std::mutex> lock(mutex_);
+					finish(e);
+				});
+			}
+		}
+		changed_.notify_all();
+
+		std::exception_ptr e;
+		try
+		{
+			task(0);
+		}
+		catch (...)
+		{
+			e = std::current_exception();
+		}
+
+		// Helps with the queued tasks (ours or those of other loops) instead of sleeping
+		std::unique_lock<std::mutex> lock(mutex_);
+		finish(e);
+		while (remaining > 0)
+		{
+			if (queue_.empty())
+			{
+				changed_.wait(lock, [&]() { return remaining == 0 || !queue_.empty(); });
+				continue;
+			}
+
+			std::function<void()> queued = std::move(queue_.front());
+			queue_.pop_front();
+			lock.unlock();
+			queued();
+			lock.lock();
+		}
+
+		if (error)
+			std::rethrow_exception(error);
+	}
+} // namespace paraviewo
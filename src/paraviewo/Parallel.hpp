@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Worker threads shared by the parallel loops of the process, started on first use and kept until exit.
+	/// A thread waiting for its tasks runs queued tasks meanwhile, so nested loops (and loops run from several
+	/// threads) cannot deadlock.
+	class ThreadPool
+	{
+	public:
+		static ThreadPool &instance();
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool &) = delete;
+		void operator=(const ThreadPool &) = delete;
+
+		/// Calls task(0), ..., task(n_tasks - 1) with up to n_tasks - 1 workers, the calling thread runs task(0).
+		/// Returns when all the tasks are done, the first exception thrown by a task is rethrown.
+		void run(const int64_t n_tasks, const std::function<void(int64_t)> &task);
+
+		inline int n_workers() const { return workers_.size(); }
+
+	private:
+		ThreadPool();
+
+		std::vector<std::thread> workers_;
+		std::deque<std::function<void()>> queue_;
+		bool stop_;
+
+		std::mutex mutex_;
+		/// Signals new tasks and finished tasks
+		std::condition_variable changed_;
+
+		void work();
+	};
+
+	/// Calls f(begin, end) on contiguous disjoint ranges covering [0, n), using up to n_threads threads of the ThreadPool.
+	/// Ranges are never smaller than min_size, small inputs are processed on the calling thread.
+	template <typename F>
+	void parallel_for(const int64_t n, const int n_threads, const F &f, const int64_t min_size = 4096)
+	{
+		const int64_t n_chunks = std::min<int64_t>(n_threads, n / std::max<int64_t>(1, min_size));
+		if (n_chunks <= 1)
+		{
+			if (n > 0)
+				f(int64_t(0), n);
+			return;
+		}
+
+		ThreadPool::instance().run(n_chunks, [&f, n, n_chunks](const int64_t t) { f(t * n / n_chunks, (t + 1) * n / n_chunks); });
+	}
+
+	/// Exclusive prefix sum of value(i) for i in [0, n): out[i] = value(0) + ... + value(i - 1), out[n] is the total (returned).
+	/// Two parallel passes over contiguous blocks, value may be called twice for the same i.
+	template <typename T, typename F>
+	T parallel_exclusive_scan(const int64_t n, const int n_threads, const F &value, T *out, const int64_t min_size = 4096)
+	{
+		const int64_t n_chunks = std::max<int64_t>(1, std::min<int64_t>(n_threads, n / std::max<int64_t>(1, min_size)));
+
+		std::vector<T> chunk_sums(n_chunks + 1, T(0));
+		parallel_for(
+			n_chunks, n_threads, [&](const int64_t begin, const int64_t end) {
+				for (int64_t c = begin; c < end; ++c)
+				{
+					T sum = T(0);
+					for (int64_t i = c * n / n_chunks; i < (c + 1) * n / n_chunks; ++i)
+						sum += value(i);
+					chunk_sums[c + 1] = sum;
+				}
+			},
+			1);
+
+		for (int64_t c = 0; c < n_chunks; ++c)
+			chunk_sums[c + 1] += chunk_sums[c];
+
+		parallel_for(
+			n_chunks, n_threads, [&](const int64_t begin, const int64_t end) {
+				for (int64_t c = begin; c < end; ++c)
+				{
+					T sum = chunk_sums[c];
+					for (int64_t i = c * n / n_chunks; i < (c + 1) * n / n_chunks; ++i)
+					{
+						out[i] = sum;
+						sum += value(i);
+					}
+				}
+			},
+			1);
+
+		out[n] = chunk_sums[n_chunks];
+		return out[n];
+	}
+} // namespace paraviewo
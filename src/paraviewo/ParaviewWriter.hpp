@@ -1,7 +1,20 @@
 #pragma once
 
+#include "Sink.hpp"
+#include "Parallel.hpp"
+#include "WriteStats.hpp"
+#include "Workspace.hpp"
+
 #include <Eigen/Dense>
 
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
 namespace paraviewo
 {
 	enum class CellType
@@ -23,6 +36,17 @@ namespace paraviewo
 		Polyhedron,
 	};
 
+	/// Order of the nodes of the high order cells passed to the unstructured writers
+	enum class NodeOrdering
+	{
+		/// Already in the VTK (Lagrange) order
+		VTK,
+		/// Gmsh order, the quadratic cells are converted (see NodeOrdering.hpp)
+		Gmsh,
+		/// Order of the application, converted with the tables of register_node_permutation
+		Custom
+	};
+
 	class CellElement
 	{
 	public:
@@ -45,6 +69,7 @@ namespace paraviewo
 		static const int VTK_POLYGON = 7;
 		static const int VTK_POLYHEDRON = 42;
 
+		static const int VTK_QUADRATIC_QUAD = 23;
 		static const int VTK_QUADRATIC_WEDGE = 26;
 		static const int VTK_BIQUADRATIC_QUADRATIC_WEDGE = 32;
 		static const int VTK_QUADRATIC_PYRAMID = 27;
@@ -84,6 +109,8 @@ namespace paraviewo
 			case CellType::Quadrilateral:
 				if (n_vertices == 4)
 					return VTK_QUAD;
+				else if (n_vertices == 8)
+					return VTK_QUADRATIC_QUAD;
 				else
 					return VTK_LAGRANGE_QUADRILATERAL;
 
@@ -134,56 +161,227 @@ namespace paraviewo
 		}
 	};
 
-	class ParaviewWriter
+	/// Produces the rows [begin, end) of a field in row-major order (n_components values per row) into out.
+	/// It may be called concurrently on disjoint ranges.
+	using FieldGenerator = std::function<void(const int64_t begin, const int64_t end, double *out)>;
+
+	/// Number of components written for a field, 2D vectors are padded to 3D
+	inline int padded_components(const int n_components)
 	{
-	public:
-		ParaviewWriter() {};
-		virtual ~ParaviewWriter() {};
+		return n_components == 2 ? 3 : n_components;
+	}
 
-		virtual bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) = 0;
-		virtual bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) = 0;
+	/// Generator reading the rows of a matrix, the matrix must outlive it
+	inline FieldGenerator matrix_generator(const Eigen::MatrixXd &data)
+	{
+		return [&data](const int64_t begin, const int64_t end, double *out) {
+			for (int64_t i = begin; i < end; ++i)
+				for (Eigen::Index d = 0; d < data.cols(); ++d)
+					*out++ = data(i, d);
+		};
+	}
+
+	/// Compact storage of the tensors of add_tensor_field, one row per point (cell)
+	enum class TensorLayout
+	{
+		/// xx, yy, zz, xy, yz, xz (VTK order), written as 6 components
+		Symmetric,
+		/// xx, yy, xy, written as 6 components
+		Symmetric2D,
+		/// Row-major xx, xy, xz, yx, yy, yz, zx, zy, zz, written as 9 components
+		Full,
+		/// Row-major xx, xy, yx, yy, written as 9 components
+		Full2D
+	};
 
-		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<std::vector<int>> &cells, const CellType ctype)
+	/// Columns of the compact storage
+	inline int tensor_columns(const TensorLayout layout)
+	{
+		switch (layout)
 		{
-			Eigen::MatrixXi cells_mat(cells.size(), cells[0].size());
-			for (int i = 0; i < cells.size(); ++i)
-				for (int j = 0; j < cells[i].size(); ++j)
-					cells_mat(i, j) = cells[i][j];
-			return write_mesh(path, points, cells_mat, ctype);
+		case TensorLayout::Symmetric:
+			return 6;
+		case TensorLayout::Symmetric2D:
+			return 3;
+		case TensorLayout::Full:
+			return 9;
+		default:
+			return 4;
 		}
+	}
 
-		void add_field(const std::string &name, const Eigen::MatrixXd &data)
+	/// Components written, 6 for symmetric tensors and 9 otherwise
+	inline int tensor_components(const TensorLayout layout)
+	{
+		return layout == TensorLayout::Symmetric || layout == TensorLayout::Symmetric2D ? 6 : 9;
+	}
+
+	/// Generator expanding compact tensors to their VTK components, the 2D ones get zero z entries
+	inline FieldGenerator tensor_generator(const std::shared_ptr<const Eigen::MatrixXd> &data, const TensorLayout layout)
+	{
+		// Source column of every written component, -1 for zeros
+		static const int SYMMETRIC_2D[6] = {0, 1, -1, 2, -1, -1};
+		static const int FULL_2D[9] = {0, 1, -1, 2, 3, -1, -1, -1, -1};
+		const int *map = layout == TensorLayout::Symmetric2D ? SYMMETRIC_2D : (layout == TensorLayout::Full2D ? FULL_2D : nullptr);
+		const int n_components = tensor_components(layout);
+
+		return [data, map, n_components](const int64_t begin, const int64_t end, double *out) {
+			const Eigen::MatrixXd &m = *data;
+			for (int64_t i = begin; i < end; ++i)
+				for (int d = 0; d < n_components; ++d)
+					*out++ = map ? (map[d] < 0 ? 0. : m(i, map[d])) : m(i, d);
+		};
+	}
+
+	/// Precision kept when a field is written. Dropping low mantissa bits makes the output lossy but much more
+	/// compressible (the zeroed bits deflate well).
+	struct FieldPrecision
+	{
+		/// Significant bits of the mantissa kept (52 keeps every bit), the values are rounded to nearest
+		int mantissa_bits = 52;
+		/// If positive, values are rounded to a multiple of the largest power of two not above it, the error is at most absolute_error / 2
+		double absolute_error = 0;
+		/// Values smaller than this are written as 0
+		double zero_threshold = 1e-16;
+	};
+
+	/// Applies precision to n values in place, branch-free loops over the bit patterns so they vectorize
+	inline void quantize_values(double *values, const int64_t n, const FieldPrecision &precision)
+	{
+		using std::abs;
+
+		for (int64_t i = 0; i < n; ++i)
+			values[i] = abs(values[i]) < precision.zero_threshold ? 0 : values[i];
+
+		if (precision.absolute_error > 0)
+		{
+			// Scaling by powers of two is exact, only the rounding loses bits
+			const double quantum = std::ldexp(1.0, std::ilogb(precision.absolute_error));
+			const double inv_quantum = 1 / quantum;
+			for (int64_t i = 0; i < n; ++i)
+				values[i] = std::nearbyint(values[i] * inv_quantum) * quantum;
+		}
+
+		if (precision.mantissa_bits < 52)
 		{
-			using std::abs;
+			const int dropped = 52 - std::max(0, precision.mantissa_bits);
+			const uint64_t half = uint64_t(1) << (dropped - 1);
+			const uint64_t mask = ~((uint64_t(1) << dropped) - 1);
+			for (int64_t i = 0; i < n; ++i)
+			{
+				uint64_t bits;
+				std::memcpy(&bits, values + i, sizeof(bits));
+				// NaN and infinities (all exponent bits set) are kept as is, rounding would turn a NaN into 0 or infinity
+				if (((bits >> 52) & 0x7FF) == 0x7FF)
+					continue;
+				// A carry out of the mantissa correctly bumps the exponent
+				bits = (bits + half) & mask;
+				std::memcpy(values + i, &bits, sizeof(bits));
+			}
+		}
+	}
+
+	/// Evaluates the rows [begin, end) of a field into out (padded_components(n_components) values per row),
+	/// in parallel chunks of rows, and applies precision.
+	inline void generate_field_block(const FieldGenerator &fill, const int n_components, const int64_t begin, const int64_t end, const int n_threads, double *out, const FieldPrecision &precision = FieldPrecision())
+	{
+		const int out_components = padded_components(n_components);
+
+		parallel_for(end - begin, n_threads, [&](const int64_t b, const int64_t e) {
+			double *block = out + b * out_components;
+			fill(begin + b, begin + e, block);
+
+			// Spread the rows from the back to make room for the padding
+			if (out_components != n_components)
+			{
+				for (int64_t i = e - b - 1; i >= 0; --i)
+				{
+					for (int d = out_components - 1; d >= n_components; --d)
+						block[i * out_components + d] = 0;
+					for (int d = n_components - 1; d >= 0; --d)
+						block[i * out_components + d] = block[i * n_components + d];
+				}
+			}
 
-			Eigen::MatrixXd tmp;
-			tmp.resizeLike(data);
+			quantize_values(block, (e - b) * out_components, precision);
+		});
+	}
 
-			for (long i = 0; i < data.size(); ++i)
-				tmp(i) = abs(data(i)) < 1e-16 ? 0 : data(i);
+	/// Field part of the writers interface, shared by all dataset types
+	class FieldWriter
+	{
+	public:
+		FieldWriter() {};
+		virtual ~FieldWriter() {};
 
-			if (tmp.cols() == 1)
-				add_scalar_field(name, tmp);
+		/// Values are written with field_precision(name), by default values smaller than 1e-16 are written as 0
+		void add_field(const std::string &name, const Eigen::MatrixXd &data)
+		{
+			if (data.cols() == 1)
+				add_scalar_field(name, data);
 			else
-				add_vector_field(name, tmp);
+				add_vector_field(name, data);
 		}
 
 		void add_cell_field(const std::string &name, const Eigen::MatrixXd &data)
 		{
-			using std::abs;
+			if (data.cols() == 1)
+				add_scalar_cell_field(name, data);
+			else
+				add_vector_cell_field(name, data);
+		}
 
-			Eigen::MatrixXd tmp;
-			tmp.resizeLike(data);
+		/// Lazy field: fill is called block by block while the file is encoded (possibly from several threads),
+		/// whatever it references must stay alive until write_mesh. The full array is never materialized.
+		void add_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill)
+		{
+			add_generated_field(name, n_rows, n_components, fill, true);
+		}
 
-			for (long i = 0; i < data.size(); ++i)
-				tmp(i) = abs(data(i)) < 1e-16 ? 0 : data(i);
+		void add_cell_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill)
+		{
+			add_generated_field(name, n_rows, n_components, fill, false);
+		}
 
-			if (tmp.cols() == 1)
-				add_scalar_cell_field(name, tmp);
-			else
-				add_vector_cell_field(name, tmp);
+		/// Tensor field given in a compact layout, expanded block by block while the file is encoded so the full
+		/// tensors are never stored. data is copied, as with add_field.
+		void add_tensor_field(const std::string &name, const Eigen::MatrixXd &data, const TensorLayout layout)
+		{
+			assert(data.cols() == tensor_columns(layout));
+			add_generated_field(name, data.rows(), tensor_components(layout), tensor_generator(std::make_shared<const Eigen::MatrixXd>(data), layout), true);
+		}
+
+		void add_tensor_cell_field(const std::string &name, const Eigen::MatrixXd &data, const TensorLayout layout)
+		{
+			assert(data.cols() == tensor_columns(layout));
+			add_generated_field(name, data.rows(), tensor_components(layout), tensor_generator(std::make_shared<const Eigen::MatrixXd>(data), layout), false);
+		}
+
+		/// Threads used to evaluate lazy fields
+		inline void set_num_threads(const int n_threads) { n_threads_ = std::max(1, n_threads); }
+
+		/// Precision of the fields added afterwards with this name
+		virtual void set_field_precision(const std::string &name, const FieldPrecision &precision) { field_precision_[name] = precision; }
+		/// Precision of the fields without a specific one
+		virtual void set_default_precision(const FieldPrecision &precision) { default_precision_ = precision; }
+
+		inline const FieldPrecision &field_precision(const std::string &name) const
+		{
+			const auto it = field_precision_.find(name);
+			return it == field_precision_.end() ? default_precision_ : it->second;
 		}
 
+		/// True if the writer calls the HDF5 library, whose calls must be serialized between threads (see hdf5_mutex)
+		virtual bool uses_hdf5() const { return false; }
+
+		/// Measurements of the last write_mesh (or session)
+		inline const WriteStats &last_write_stats() const { return stats_; }
+
+		/// Scratch memory of the writes (block buffers, index arrays), by default owned by the writer.
+		/// Writers used in turn can share one, nullptr goes back to the owned workspace.
+		inline void set_workspace(Workspace *workspace) { external_workspace_ = workspace; }
+		inline Workspace &workspace() const { return external_workspace_ ? *external_workspace_ : workspace_; }
+
 		virtual void clear() = 0;
 
 	protected:
@@ -192,5 +390,71 @@ namespace paraviewo
 
 		virtual void add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data) = 0;
 		virtual void add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data) = 0;
+
+		virtual void add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point) = 0;
+
+		int n_threads_ = 1;
+		WriteStats stats_;
+
+		/// Called at the start of every write_mesh (or begin_mesh): recycles the workspace and resets the stats
+		void begin_write()
+		{
+			stats_.clear();
+			workspace().reset();
+			allocations_ = workspace().n_allocations();
+		}
+		/// Called at the end of the write, records the workspace usage
+		void end_write()
+		{
+			stats_.allocations = workspace().n_allocations() - allocations_;
+			stats_.workspace_bytes = workspace().capacity();
+		}
+
+	private:
+		std::map<std::string, FieldPrecision> field_precision_;
+		FieldPrecision default_precision_;
+
+		mutable Workspace workspace_;
+		Workspace *external_workspace_ = nullptr;
+		size_t allocations_ = 0;
+	};
+
+	/// Unstructured meshes
+	class ParaviewWriter : public FieldWriter
+	{
+	public:
+		ParaviewWriter() {};
+		virtual ~ParaviewWriter() {};
+
+		virtual bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) = 0;
+		virtual bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) = 0;
+
+		virtual bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) = 0;
+		virtual bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) = 0;
+
+		/// Session API: begin_mesh writes the geometry right away, then every field passed to add_field/add_cell_field
+		/// is encoded and flushed immediately instead of being kept until the end, end_mesh completes the file.
+		/// Point fields must be added before cell fields.
+		virtual bool begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) = 0;
+		virtual bool begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) = 0;
+		virtual bool begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) = 0;
+		virtual bool begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) = 0;
+		virtual bool end_mesh() = 0;
+
+		/// Node order of the cells passed to write_mesh, converted to the VTK order while the connectivity is written
+		inline void set_node_ordering(const NodeOrdering ordering) { node_ordering_ = ordering; }
+		inline NodeOrdering node_ordering() const { return node_ordering_; }
+
+		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<std::vector<int>> &cells, const CellType ctype)
+		{
+			Eigen::MatrixXi cells_mat(cells.size(), cells[0].size());
+			for (size_t i = 0; i < cells.size(); ++i)
+				for (size_t j = 0; j < cells[i].size(); ++j)
+					cells_mat(i, j) = cells[i][j];
+			return write_mesh(path, points, cells_mat, ctype);
+		}
+
+	private:
+		NodeOrdering node_ordering_ = NodeOrdering::VTK;
 	};
 } // namespace paraviewo
@@ -0,0 +1,66 @@
+#include "Polyhedra.hpp"
+
+#include "Parallel.hpp"
+
+#include <algorithm>
+
+namespace paraviewo
+{
+	namespace
+	{
+		// Sorted distinct vertices of the faces of cell c in points (cleared first)
+		void cell_points(const PolyhedralCells &cells, const int64_t c, std::vector<int64_t> &points)
+		{
+			points.clear();
+			for (int64_t k = cells.cell_offsets[c]; k < cells.cell_offsets[c + 1]; ++k)
+			{
+				const int64_t f = cells.cell_faces[k];
+				points.insert(points.end(), cells.face_vertices.begin() + cells.face_offsets[f], cells.face_vertices.begin() + cells.face_offsets[f + 1]);
+			}
+			std::sort(points.begin(), points.end());
+			points.erase(std::unique(points.begin(), points.end()), points.end());
+		}
+	} // namespace
+
+	PolyhedronPoints polyhedron_points(const PolyhedralCells &cells, const int n_threads, Workspace &workspace)
+	{
+		const int64_t n_cells = cells.n_cells();
+
+		PolyhedronPoints result;
+		result.offsets = workspace.allocate<int64_t>(n_cells + 1);
+
+		int64_t *counts = workspace.allocate<int64_t>(n_cells);
+		parallel_for(n_cells, n_threads, [&](const int64_t begin, const int64_t end) {
+			std::vector<int64_t> points;
+			for (int64_t c = begin; c < end; ++c)
+			{
+				cell_points(cells, c, points);
+				counts[c] = points.size();
+			}
+		});
+
+		const int64_t n_points = parallel_exclusive_scan<int64_t>(
+			n_cells, n_threads, [&](const int64_t c) { return counts[c]; }, result.offsets);
+
+		result.points = workspace.allocate<int64_t>(n_points);
+		parallel_for(n_cells, n_threads, [&](const int64_t begin, const int64_t end) {
+			std::vector<int64_t> points;
+			for (int64_t c = begin; c < end; ++c)
+			{
+				cell_points(cells, c, points);
+				std::copy(points.begin(), points.end(), result.points + result.offsets[c]);
+			}
+		});
+
+		return result;
+	}
+
+	int64_t *polyhedron_stream_offsets(const PolyhedralCells &cells, const int n_threads, Workspace &workspace)
+	{
+		const int64_t n_cells = cells.n_cells();
+		int64_t *offsets = workspace.allocate<int64_t>(n_cells + 1);
+		parallel_exclusive_scan<int64_t>(
+			n_cells, n_threads, [&](const int64_t c) { return cells.stream_size(c); }, offsets);
+		return offsets;
+	}
+} // namespace paraviewo
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Workspace.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Polyhedral cells in compressed rows, without per-face vectors: the faces of cell c are
+	/// cell_faces[cell_offsets[c]] ... cell_faces[cell_offsets[c + 1] - 1] and the vertices of face f are
+	/// face_vertices[face_offsets[f]] ... face_vertices[face_offsets[f + 1] - 1], ordered so that the normal points
+	/// out of the cells using the face. A face can be shared by two cells.
+	class PolyhedralCells
+	{
+	public:
+		std::vector<int64_t> face_vertices;
+		std::vector<int64_t> face_offsets = {0};
+		std::vector<int64_t> cell_faces;
+		std::vector<int64_t> cell_offsets = {0};
+
+		inline int64_t n_cells() const { return cell_offsets.size() - 1; }
+		inline int64_t n_faces() const { return face_offsets.size() - 1; }
+
+		/// Entries of the cell in the VTK faces stream: its number of faces, then the size and vertices of every face
+		inline int64_t stream_size(const int64_t c) const
+		{
+			int64_t size = 1 + cell_offsets[c + 1] - cell_offsets[c];
+			for (int64_t k = cell_offsets[c]; k < cell_offsets[c + 1]; ++k)
+				size += face_offsets[cell_faces[k] + 1] - face_offsets[cell_faces[k]];
+			return size;
+		}
+	};
+
+	/// Points of every polyhedron, the sorted distinct vertices of its faces, in compressed rows: the connectivity
+	/// VTK expects with the faces. Both arrays are allocated in the workspace.
+	struct PolyhedronPoints
+	{
+		/// n_cells + 1 entries
+		int64_t *offsets;
+		int64_t *points;
+	};
+
+	/// Two parallel passes over the cells (count, then fill)
+	PolyhedronPoints polyhedron_points(const PolyhedralCells &cells, const int n_threads, Workspace &workspace);
+
+	/// Offsets of the cells in the VTK faces stream (n_cells + 1 entries, allocated in the workspace)
+	int64_t *polyhedron_stream_offsets(const PolyhedralCells &cells, const int n_threads, Workspace &workspace);
+} // namespace paraviewo
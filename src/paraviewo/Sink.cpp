@@ -0,0 +1,181 @@
+#include "Sink.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace paraviewo
+{
+	FileSink::FileSink(const std::string &path)
+		: file_(std::fopen(path.c_str(), "wb")), good_(file_ != nullptr)
+	{
+	}
+
+	FileSink::~FileSink()
+	{
+		close();
+	}
+
+	void FileSink::write(const char *data, const size_t size)
+	{
+		if (!good_ || size == 0)
+			return;
+
+		good_ = file_ != nullptr && std::fwrite(data, 1, size, file_) == size;
+	}
+
+	void FileSink::flush()
+	{
+		if (file_ != nullptr && good_)
+			good_ = std::fflush(file_) == 0;
+	}
+
+	void FileSink::close()
+	{
+		if (file_ == nullptr)
+			return;
+
+		good_ = std::fclose(file_) == 0 && good_;
+		file_ = nullptr;
+	}
+
+	void MemorySink::write(const char *data, const size_t size)
+	{
+		buffer_.insert(buffer_.end(), data, data + size);
+	}
+
+	CallbackSink::CallbackSink(const Callback &callback, const size_t chunk_size)
+		: callback_(callback), chunk_size_(chunk_size), good_(true)
+	{
+		chunk_.reserve(chunk_size_);
+	}
+
+	CallbackSink::~CallbackSink()
+	{
+		flush();
+	}
+
+	void CallbackSink::write(const char *data, const size_t size)
+	{
+		if (!good_)
+			return;
+
+		// Large writes go straight to the callback, no need to copy them
+		if (chunk_.empty() && size >= chunk_size_)
+		{
+			good_ = callback_(data, size);
+			return;
+		}
+
+		size_t done = 0;
+		while (done < size && good_)
+		{
+			const size_t n = std::min(size - done, chunk_size_ - chunk_.size());
+			chunk_.insert(chunk_.end(), data + done, data + done + n);
+			done += n;
+
+			if (chunk_.size() >= chunk_size_)
+			{
+				good_ = callback_(chunk_.data(), chunk_.size());
+				chunk_.clear();
+			}
+		}
+	}
+
+	void CallbackSink::flush()
+	{
+		if (good_ && !chunk_.empty())
+			good_ = callback_(chunk_.data(), chunk_.size());
+		chunk_.clear();
+	}
+
+	FdSink::FdSink(const int fd)
+		: fd_(fd), good_(true)
+	{
+	}
+
+	void FdSink::write(const char *data, const size_t size)
+	{
+		size_t done = 0;
+		while (good() && done < size)
+		{
+#ifdef _WIN32
+			const int n = ::_write(fd_, data + done, static_cast<unsigned int>(std::min<size_t>(size - done, 1 << 30)));
+#else
+			const ssize_t n = ::write(fd_, data + done, size - done);
+#endif
+			if (n < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				good_ = false;
+			}
+			else
+				done += n;
+		}
+	}
+
+	SinkStreamBuf::SinkStreamBuf(Sink &sink, const size_t buffer_size)
+		: sink_(sink), buffer_(buffer_size)
+	{
+		setp(buffer_.data(), buffer_.data() + buffer_.size());
+	}
+
+	SinkStreamBuf::~SinkStreamBuf()
+	{
+		sync();
+	}
+
+	void SinkStreamBuf::flush_buffer()
+	{
+		const std::ptrdiff_t n = pptr() - pbase();
+		if (n > 0)
+			sink_.write(pbase(), n);
+		setp(buffer_.data(), buffer_.data() + buffer_.size());
+	}
+
+	SinkStreamBuf::int_type SinkStreamBuf::overflow(int_type ch)
+	{
+		flush_buffer();
+		if (!traits_type::eq_int_type(ch, traits_type::eof()))
+		{
+			*pptr() = traits_type::to_char_type(ch);
+			pbump(1);
+		}
+		return sink_.good() ? traits_type::not_eof(ch) : traits_type::eof();
+	}
+
+	std::streamsize SinkStreamBuf::xsputn(const char *s, std::streamsize n)
+	{
+		if (n <= epptr() - pptr())
+		{
+			std::memcpy(pptr(), s, n);
+			pbump(static_cast<int>(n));
+			return n;
+		}
+
+		// Bigger than the buffer, forward it in one piece
+		flush_buffer();
+		if (static_cast<size_t>(n) >= buffer_.size())
+			sink_.write(s, n);
+		else
+		{
+			std::memcpy(pptr(), s, n);
+			pbump(static_cast<int>(n));
+		}
+		return sink_.good() ? n : 0;
+	}
+
+	int SinkStreamBuf::sync()
+	{
+		flush_buffer();
+		sink_.flush();
+		return sink_.good() ? 0 : -1;
+	}
+} // namespace paraviewo
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Destination of the bytes produced by a writer
+	class Sink
+	{
+	public:
+		Sink() {};
+		virtual ~Sink() {};
+
+		/// Appends size bytes to the sink
+		virtual void write(const char *data, const size_t size) = 0;
+		/// Pushes any buffered bytes to the destination
+		virtual void flush() {};
+		/// False as soon as a write failed
+		virtual bool good() const = 0;
+	};
+
+	/// Writes to a file on disk
+	class FileSink : public Sink
+	{
+	public:
+		FileSink(const std::string &path);
+		~FileSink();
+
+		void write(const char *data, const size_t size) override;
+		void flush() override;
+		bool good() const override { return good_; }
+
+		void close();
+
+	private:
+		std::FILE *file_;
+		bool good_;
+	};
+
+	/// Grows a contiguous memory buffer, the result is available with buffer()
+	class MemorySink : public Sink
+	{
+	public:
+		void write(const char *data, const size_t size) override;
+		bool good() const override { return true; }
+
+		inline const std::vector<char> &buffer() const { return buffer_; }
+		inline std::vector<char> &buffer() { return buffer_; }
+		inline void clear() { buffer_.clear(); }
+
+	private:
+		std::vector<char> buffer_;
+	};
+
+	/// Hands the output to a user callback in contiguous chunks of (at least) chunk_size bytes, only the last chunk can be smaller
+	class CallbackSink : public Sink
+	{
+	public:
+		/// Returns false to abort the writing
+		using Callback = std::function<bool(const char *data, const size_t size)>;
+
+		CallbackSink(const Callback &callback, const size_t chunk_size = 4 << 20);
+		~CallbackSink();
+
+		void write(const char *data, const size_t size) override;
+		void flush() override;
+		bool good() const override { return good_; }
+
+	private:
+		Callback callback_;
+		size_t chunk_size_;
+		std::vector<char> chunk_;
+		bool good_;
+	};
+
+	/// Writes to an already opened file descriptor (file, pipe, Unix socket), the descriptor is not closed
+	class FdSink : public Sink
+	{
+	public:
+		FdSink(const int fd);
+
+		void write(const char *data, const size_t size) override;
+		bool good() const override { return fd_ >= 0 && good_; }
+
+	private:
+		int fd_;
+		bool good_;
+	};
+
+	/// std::streambuf forwarding to a Sink, used to plug sinks into std::ostream based writers
+	class SinkStreamBuf : public std::streambuf
+	{
+	public:
+		SinkStreamBuf(Sink &sink, const size_t buffer_size = 1 << 20);
+		~SinkStreamBuf();
+
+	protected:
+		int_type overflow(int_type ch) override;
+		std::streamsize xsputn(const char *s, std::streamsize n) override;
+		int sync() override;
+
+	private:
+		Sink &sink_;
+		std::vector<char> buffer_;
+
+		void flush_buffer();
+	};
+} // namespace paraviewo
@@ -0,0 +1,76 @@
+#include "VTIWriter.hpp"
+
+#include <limits>
+
+namespace paraviewo
+{
+
+	VTIWriter::VTIWriter(bool binary)
+		: binary_(binary), fields_(binary)
+	{
+	}
+
+	void VTIWriter::clear()
+	{
+		fields_.clear();
+	}
+
+	void VTIWriter::add_scalar_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_scalar_field(name, data, true, field_precision(name));
+	}
+
+	void VTIWriter::add_vector_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_vector_field(name, data, true, field_precision(name));
+	}
+
+	void VTIWriter::add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_scalar_field(name, data, false, field_precision(name));
+	}
+
+	void VTIWriter::add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_vector_field(name, data, false, field_precision(name));
+	}
+
+	void VTIWriter::add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point)
+	{
+		fields_.add_generated_field(name, n_rows, n_components, fill, n_threads_, is_point, field_precision(name));
+	}
+
+	bool VTIWriter::write_mesh(const std::string &path, const Eigen::Vector3d &origin, const Eigen::Vector3d &spacing, const Eigen::Vector3i &n_points)
+	{
+		FileSink sink(path);
+		if (!sink.good())
+			return false;
+
+		return write_mesh(sink, origin, spacing, n_points);
+	}
+
+	bool VTIWriter::write_mesh(Sink &sink, const Eigen::Vector3d &origin, const Eigen::Vector3d &spacing, const Eigen::Vector3i &n_points)
+	{
+		begin_write();
+		SinkStreamBuf buffer(sink);
+		std::ostream os(&buffer);
+		os.precision(std::numeric_limits<double>::max_digits10);
+
+		const std::string extent = vtk_extent(n_points);
+
+		os << "<VTKFile type=\"ImageData\" version=\"1.0\" header_type=\"UInt64\">\n";
+		os << "<ImageData WholeExtent=\"" << extent << "\" Origin=\"" << origin(0) << " " << origin(1) << " " << origin(2)
+		   << "\" Spacing=\"" << spacing(0) << " " << spacing(1) << " " << spacing(2) << "\">\n";
+		os << "<Piece Extent=\"" << extent << "\">\n";
+		fields_.write_point_data(os, workspace());
+		fields_.write_cell_data(os, workspace());
+		os << "</Piece>\n";
+		os << "</ImageData>\n";
+		os << "</VTKFile>\n";
+
+		os.flush();
+		end_write();
+		clear();
+		return sink.good();
+	}
+} // namespace paraviewo
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ParaviewWriter.hpp"
+#include "VTKFieldData.hpp"
+
+#include <Eigen/Dense>
+
+#include <iostream>
+#include <string>
+
+namespace paraviewo
+{
+	/// Uniform grids (.vti), only origin, spacing and number of points per axis are stored.
+	/// Point fields are ordered with x varying fastest, then y, then z.
+	class VTIWriter : public FieldWriter
+	{
+	public:
+		VTIWriter(bool binary = true);
+
+		/// n_points(2) == 1 for 2D grids
+		bool write_mesh(const std::string &path, const Eigen::Vector3d &origin, const Eigen::Vector3d &spacing, const Eigen::Vector3i &n_points);
+		bool write_mesh(Sink &sink, const Eigen::Vector3d &origin, const Eigen::Vector3d &spacing, const Eigen::Vector3i &n_points);
+
+		void clear() override;
+
+	protected:
+		void add_scalar_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point) override;
+
+	private:
+		bool binary_;
+		VTKFieldData fields_;
+	};
+} // namespace paraviewo
@@ -0,0 +1,192 @@
+#include "VTKFieldData.hpp"
+
+namespace paraviewo
+{
+
+	void write_vtk_points(const Eigen::MatrixXd &points, const bool binary, std::ostream &os, Workspace &workspace)
+	{
+		static const int64_t BLOCK = 1 << 16;
+
+		const int64_t n_points = points.rows();
+		const int dim = std::min<int>(3, points.cols());
+
+		os << "<Points>\n";
+		if (binary)
+		{
+			base64Layer base64(os);
+
+			os << "<DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"binary\">\n";
+			const uint64_t size = n_points * 3 * sizeof(double);
+			base64.write(size);
+
+			// Interleaved block by block, 2D points get z = 0
+			Workspace::Scope scope(workspace);
+			double *block = workspace.allocate<double>(std::min(BLOCK, n_points) * 3);
+			std::fill(block, block + std::min(BLOCK, n_points) * 3, 0.);
+			for (int64_t begin = 0; begin < n_points; begin += BLOCK)
+			{
+				const int64_t end = std::min(n_points, begin + BLOCK);
+				for (int64_t i = begin; i < end; ++i)
+					for (int d = 0; d < dim; ++d)
+						block[(i - begin) * 3 + d] = points(i, d);
+
+				base64.write(block, (end - begin) * 3);
+			}
+			base64.close();
+			os << "\n";
+		}
+		else
+		{
+			os << "<DataArray type=\"Float32\" NumberOfComponents=\"3\" format=\"ascii\">\n";
+
+			for (int64_t d = 0; d < points.rows(); ++d)
+			{
+
+				for (int i = 0; i < points.cols(); ++i)
+				{
+					os << points(d, i);
+					if (i < points.cols() - 1)
+					{
+						os << " ";
+					}
+				}
+
+				if (!(points.cols() == 3))
+					os << " 0";
+
+				os << "\n";
+			}
+		}
+
+		os << "</DataArray>\n";
+		os << "</Points>\n";
+	}
+
+	void write_vtk_int64_array(const std::string &name, const int64_t n, const Int64Generator &fill, const bool binary, std::ostream &os, Workspace &workspace)
+	{
+		static const int64_t BLOCK = 1 << 16;
+
+		os << "<DataArray type=\"Int64\" Name=\"" << name << "\" format=\"" << (binary ? "binary" : "ascii") << "\">\n";
+
+		base64Layer base64(os);
+		if (binary)
+		{
+			const uint64_t size = n * sizeof(int64_t);
+			base64.write(size);
+		}
+
+		Workspace::Scope scope(workspace);
+		int64_t *block = workspace.allocate<int64_t>(std::min(BLOCK, n));
+		for (int64_t begin = 0; begin < n; begin += BLOCK)
+		{
+			const int64_t end = std::min(n, begin + BLOCK);
+			fill(begin, end, block);
+
+			if (binary)
+				base64.write(block, end - begin);
+			else
+			{
+				for (int64_t i = 0; i < end - begin; ++i)
+					os << block[i] << "\n";
+			}
+		}
+
+		if (binary)
+		{
+			base64.close();
+			os << "\n";
+		}
+		os << "</DataArray>\n";
+	}
+
+	VTKFieldData::VTKFieldData(bool binary)
+		: binary_(binary), n_point_data_(0), n_cell_data_(0)
+	{
+	}
+
+	void VTKFieldData::write_data(const std::string &tag, const std::vector<VTKDataNode<double>> &data, const size_t n_data, const std::string &scalars, const std::string &vectors, const std::string &tensors, std::ostream &os, Workspace &workspace)
+	{
+		if (n_data == 0)
+			return;
+
+		os << "<" << tag << " ";
+		if (!scalars.empty())
+			os << "Scalars=\"" << scalars << "\" ";
+		if (!vectors.empty())
+			os << "Vectors=\"" << vectors << "\" ";
+		if (!tensors.empty())
+			os << "Tensors=\"" << tensors << "\" ";
+		os << ">\n";
+
+		for (size_t i = 0; i < n_data; ++i)
+		{
+			data[i].write(os, workspace);
+		}
+
+		os << "</" << tag << ">\n";
+	}
+
+	void VTKFieldData::write_point_data(std::ostream &os, Workspace &workspace) const
+	{
+		write_data("PointData", point_data_, n_point_data_, current_scalar_point_data_, current_vector_point_data_, current_tensor_point_data_, os, workspace);
+	}
+
+	void VTKFieldData::write_cell_data(std::ostream &os, Workspace &workspace) const
+	{
+		write_data("CellData", cell_data_, n_cell_data_, current_scalar_cell_data_, current_vector_cell_data_, current_tensor_cell_data_, os, workspace);
+	}
+
+	void VTKFieldData::permute_cell_data(const std::shared_ptr<const std::vector<int64_t>> &order)
+	{
+		for (size_t i = 0; i < n_cell_data_; ++i)
+			cell_data_[i].permute_rows(order);
+	}
+
+	void VTKFieldData::clear()
+	{
+		n_point_data_ = 0;
+		current_scalar_point_data_.clear();
+		current_vector_point_data_.clear();
+		current_tensor_point_data_.clear();
+
+		n_cell_data_ = 0;
+		current_scalar_cell_data_.clear();
+		current_vector_cell_data_.clear();
+		current_tensor_cell_data_.clear();
+	}
+
+	VTKDataNode<double> &VTKFieldData::next_node(const bool is_point)
+	{
+		std::vector<VTKDataNode<double>> &nodes = is_point ? point_data_ : cell_data_;
+		size_t &n_nodes = is_point ? n_point_data_ : n_cell_data_;
+		if (n_nodes == nodes.size())
+			nodes.push_back(VTKDataNode<double>(binary_));
+		return nodes[n_nodes++];
+	}
+
+	void VTKFieldData::add_scalar_field(const std::string &name, const Eigen::MatrixXd &data, const bool is_point, const FieldPrecision &precision)
+	{
+		next_node(is_point).initialize(name, "Float64", data, 1, precision);
+		(is_point ? current_scalar_point_data_ : current_scalar_cell_data_) = name;
+	}
+
+	void VTKFieldData::add_vector_field(const std::string &name, const Eigen::MatrixXd &data, const bool is_point, const FieldPrecision &precision)
+	{
+		// 2D vectors are padded with z = 0
+		next_node(is_point).initialize(name, "Float64", data, padded_components(data.cols()), precision);
+		(is_point ? current_vector_point_data_ : current_vector_cell_data_) = name;
+	}
+
+	void VTKFieldData::add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const int n_threads, const bool is_point, const FieldPrecision &precision)
+	{
+		next_node(is_point).initialize(name, "Float64", n_rows, n_components, fill, n_threads, precision);
+
+		// 6 and 9 components are symmetric and full tensors
+		if (n_components == 1)
+			(is_point ? current_scalar_point_data_ : current_scalar_cell_data_) = name;
+		else if (n_components == 6 || n_components == 9)
+			(is_point ? current_tensor_point_data_ : current_tensor_cell_data_) = name;
+		else
+			(is_point ? current_vector_point_data_ : current_vector_cell_data_) = name;
+	}
+} // namespace paraviewo
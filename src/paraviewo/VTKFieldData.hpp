@@ -0,0 +1,241 @@
+#pragma once
+
+#include "ParaviewWriter.hpp"
+
+#include "base64Layer.hpp"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace paraviewo
+{
+
+	template <typename T>
+	class VTKDataNode
+	{
+
+	public:
+		VTKDataNode(bool binary)
+			: binary_(binary), n_rows_(0), n_threads_(1)
+		{
+		}
+
+		VTKDataNode(const std::string &name, const double binary, const std::string &numeric_type, const Eigen::MatrixXd &data = Eigen::MatrixXd(), const int n_components = 1)
+			: name_(name), binary_(binary), numeric_type_(numeric_type), data_(binary_ ? data.transpose() : data), n_components_(n_components), n_rows_(0), n_threads_(1)
+		{
+		}
+
+		// const inline Eigen::MatrixXd &data() { return data_; }
+
+		/// The columns of data are padded with zeros to n_components. The storage of the node is reused when the
+		/// size does not change, so that nodes can be recycled from one write to the next.
+		void initialize(const std::string &name, const std::string &numeric_type, const Eigen::MatrixXd &data, const int n_components = 1, const FieldPrecision &precision = FieldPrecision())
+		{
+			assert(n_components >= data.cols());
+			name_ = name;
+			numeric_type_ = numeric_type;
+			n_components_ = n_components;
+			n_rows_ = 0;
+			generator_ = nullptr;
+
+			const int padding = n_components - data.cols();
+			if (binary_)
+			{
+				data_.resize(n_components, data.rows());
+				data_.topRows(data.cols()) = data.transpose().template cast<T>();
+				data_.bottomRows(padding).setZero();
+			}
+			else
+			{
+				data_.resize(data.rows(), n_components);
+				data_.leftCols(data.cols()) = data.template cast<T>();
+				data_.rightCols(padding).setZero();
+			}
+
+			quantize_values(data_.data(), data_.size(), precision);
+		}
+
+		/// Lazy data, evaluated block by block (with n_threads threads) when written
+		void initialize(const std::string &name, const std::string &numeric_type, const int64_t n_rows, const int n_components, const FieldGenerator &generator, const int n_threads = 1, const FieldPrecision &precision = FieldPrecision())
+		{
+			name_ = name;
+			numeric_type_ = numeric_type;
+			n_components_ = n_components;
+			n_rows_ = n_rows;
+			generator_ = generator;
+			n_threads_ = n_threads;
+			precision_ = precision;
+		}
+
+		/// Row i becomes the row order[i] of the data, e.g., cells regrouped by the writer. Generated data is
+		/// gathered row by row when written.
+		void permute_rows(const std::shared_ptr<const std::vector<int64_t>> &order)
+		{
+			if (generator_)
+			{
+				const FieldGenerator fill = generator_;
+				const int n_components = n_components_;
+				generator_ = [fill, order, n_components](const int64_t begin, const int64_t end, double *out) {
+					for (int64_t i = begin; i < end; ++i)
+						fill((*order)[i], (*order)[i] + 1, out + (i - begin) * n_components);
+				};
+				n_rows_ = order->size();
+				return;
+			}
+
+			const int64_t n = order->size();
+			Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> permuted(binary_ ? data_.rows() : n, binary_ ? n : data_.cols());
+			for (int64_t i = 0; i < n; ++i)
+			{
+				if (binary_)
+					permuted.col(i) = data_.col((*order)[i]);
+				else
+					permuted.row(i) = data_.row((*order)[i]);
+			}
+			data_.swap(permuted);
+		}
+
+		/// Block buffers are taken from workspace
+		void write(std::ostream &os, Workspace &workspace) const
+		{
+			if (generator_)
+			{
+				write_generated(os, workspace);
+				return;
+			}
+
+			if (binary_)
+			{
+				base64Layer base64(os);
+
+				os << "<DataArray type=\"" << numeric_type_ << "\" Name=\"" << name_ << "\" NumberOfComponents=\"" << n_components_ << "\" format=\"binary\">\n";
+				const uint64_t size = data_.size() * sizeof(T);
+				base64.write(size);
+
+				base64.write(data_.data(), data_.size());
+				base64.close();
+				os << "\n";
+			}
+			else
+			{
+				os << "<DataArray type=\"" << numeric_type_ << "\" Name=\"" << name_ << "\" NumberOfComponents=\"" << n_components_ << "\" format=\"ascii\">\n";
+				os << data_;
+			}
+			os << "</DataArray>\n";
+		}
+
+		inline bool empty() const { return generator_ ? n_rows_ <= 0 : data_.size() <= 0; }
+
+	private:
+		std::string name_;
+		bool binary_;
+		/// Float32/
+		std::string numeric_type_;
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> data_;
+		int n_components_;
+
+		int64_t n_rows_;
+		FieldGenerator generator_;
+		int n_threads_;
+		FieldPrecision precision_;
+
+		void write_generated(std::ostream &os, Workspace &workspace) const
+		{
+			static const int64_t BLOCK_ROWS = 1 << 16;
+
+			const int out_components = padded_components(n_components_);
+			Workspace::Scope scope(workspace);
+			double *block = workspace.allocate<double>(std::min(BLOCK_ROWS, n_rows_) * out_components);
+
+			os << "<DataArray type=\"" << numeric_type_ << "\" Name=\"" << name_ << "\" NumberOfComponents=\"" << out_components << "\" format=\"" << (binary_ ? "binary" : "ascii") << "\">\n";
+
+			base64Layer base64(os);
+			if (binary_)
+			{
+				const uint64_t size = n_rows_ * out_components * sizeof(double);
+				base64.write(size);
+			}
+
+			for (int64_t begin = 0; begin < n_rows_; begin += BLOCK_ROWS)
+			{
+				const int64_t end = std::min(n_rows_, begin + BLOCK_ROWS);
+				generate_field_block(generator_, n_components_, begin, end, n_threads_, block, precision_);
+
+				if (binary_)
+					base64.write(block, (end - begin) * out_components);
+				else
+				{
+					for (int64_t i = 0; i < (end - begin) * out_components; ++i)
+						os << block[i] << ((i + 1) % out_components == 0 ? "\n" : " ");
+				}
+			}
+
+			if (binary_)
+			{
+				base64.close();
+				os << "\n";
+			}
+			os << "</DataArray>\n";
+		}
+	};
+
+	/// Extent "0 nx-1 0 ny-1 0 nz-1" of a structured grid with n_points points per axis
+	inline std::string vtk_extent(const Eigen::Vector3i &n_points)
+	{
+		return "0 " + std::to_string(std::max(0, n_points(0) - 1)) + " 0 " + std::to_string(std::max(0, n_points(1) - 1)) + " 0 " + std::to_string(std::max(0, n_points(2) - 1));
+	}
+
+	/// Produces the entries [begin, end) of an index array
+	using Int64Generator = std::function<void(const int64_t begin, const int64_t end, int64_t *out)>;
+
+	/// Points section, 2D points are padded with z = 0
+	void write_vtk_points(const Eigen::MatrixXd &points, const bool binary, std::ostream &os, Workspace &workspace);
+	/// Index DataArray encoded block by block, the array is never materialized
+	void write_vtk_int64_array(const std::string &name, const int64_t n, const Int64Generator &fill, const bool binary, std::ostream &os, Workspace &workspace);
+
+	/// PointData and CellData sections of the VTK XML formats, shared by the XML writers
+	class VTKFieldData
+	{
+	public:
+		VTKFieldData(bool binary);
+
+		void add_scalar_field(const std::string &name, const Eigen::MatrixXd &data, const bool is_point, const FieldPrecision &precision = FieldPrecision());
+		void add_vector_field(const std::string &name, const Eigen::MatrixXd &data, const bool is_point, const FieldPrecision &precision = FieldPrecision());
+		void add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const int n_threads, const bool is_point, const FieldPrecision &precision = FieldPrecision());
+
+		void write_point_data(std::ostream &os, Workspace &workspace) const;
+		void write_cell_data(std::ostream &os, Workspace &workspace) const;
+
+		/// Cell i of the written mesh is the cell order[i] of the fields added so far
+		void permute_cell_data(const std::shared_ptr<const std::vector<int64_t>> &order);
+
+		/// Keeps the nodes, their storage is reused by the next fields
+		void clear();
+
+	private:
+		bool binary_;
+
+		/// Only the first n_point_data_ (n_cell_data_) nodes are in use
+		std::vector<VTKDataNode<double>> point_data_;
+		size_t n_point_data_;
+		std::string current_scalar_point_data_;
+		std::string current_vector_point_data_;
+		std::string current_tensor_point_data_;
+
+		std::vector<VTKDataNode<double>> cell_data_;
+		size_t n_cell_data_;
+		std::string current_scalar_cell_data_;
+		std::string current_vector_cell_data_;
+		std::string current_tensor_cell_data_;
+
+		VTKDataNode<double> &next_node(const bool is_point);
+		static void write_data(const std::string &tag, const std::vector<VTKDataNode<double>> &data, const size_t n_data, const std::string &scalars, const std::string &vectors, const std::string &tensors, std::ostream &os, Workspace &workspace);
+	};
+} // namespace paraviewo
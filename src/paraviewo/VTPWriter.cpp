@@ -0,0 +1,216 @@
+#include "VTPWriter.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+namespace paraviewo
+{
+
+	VTPWriter::VTPWriter(bool binary)
+		: binary_(binary), fields_(binary)
+	{
+	}
+
+	void VTPWriter::clear()
+	{
+		fields_.clear();
+	}
+
+	void VTPWriter::add_scalar_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_scalar_field(name, data, true, field_precision(name));
+	}
+
+	void VTPWriter::add_vector_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_vector_field(name, data, true, field_precision(name));
+	}
+
+	void VTPWriter::add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_scalar_field(name, data, false, field_precision(name));
+	}
+
+	void VTPWriter::add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_vector_field(name, data, false, field_precision(name));
+	}
+
+	void VTPWriter::add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point)
+	{
+		fields_.add_generated_field(name, n_rows, n_components, fill, n_threads_, is_point, field_precision(name));
+	}
+
+	int VTPWriter::section(const CellType ctype)
+	{
+		switch (ctype)
+		{
+		case CellType::Vertex:
+			return Verts;
+		case CellType::Line:
+			return Lines;
+		case CellType::Triangle:
+		case CellType::Quadrilateral:
+		case CellType::Polygon:
+			return Polys;
+		default:
+			return -1;
+		}
+	}
+
+	void VTPWriter::write_section(const std::string &name, const SectionData &data, std::ostream &os)
+	{
+		if (data.n_cells <= 0)
+			return;
+
+		os << "<" << name << ">\n";
+		write_vtk_int64_array("connectivity", data.n_connectivity, data.connectivity, binary_, os, workspace());
+		write_vtk_int64_array("offsets", data.n_cells, data.offsets, binary_, os, workspace());
+		os << "</" << name << ">\n";
+	}
+
+	bool VTPWriter::write(Sink &sink, const Eigen::MatrixXd &points, const std::array<SectionData, 3> &sections)
+	{
+		begin_write();
+		SinkStreamBuf buffer(sink);
+		std::ostream os(&buffer);
+
+		os << "<VTKFile type=\"PolyData\" version=\"1.0\" header_type=\"UInt64\">\n";
+		os << "<PolyData>\n";
+		os << "<Piece NumberOfPoints=\"" << points.rows() << "\" NumberOfVerts=\"" << sections[Verts].n_cells << "\" NumberOfLines=\"" << sections[Lines].n_cells
+		   << "\" NumberOfStrips=\"0\" NumberOfPolys=\"" << sections[Polys].n_cells << "\">\n";
+
+		write_vtk_points(points, binary_, os, workspace());
+		fields_.write_point_data(os, workspace());
+		fields_.write_cell_data(os, workspace());
+
+		write_section("Verts", sections[Verts], os);
+		write_section("Lines", sections[Lines], os);
+		write_section("Polys", sections[Polys], os);
+
+		os << "</Piece>\n";
+		os << "</PolyData>\n";
+		os << "</VTKFile>\n";
+
+		os.flush();
+		end_write();
+		clear();
+		return sink.good();
+	}
+
+	bool VTPWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		FileSink sink(path);
+		if (!sink.good())
+			return false;
+
+		return write_mesh(sink, points, cells, ctype);
+	}
+
+	bool VTPWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		FileSink sink(path);
+		if (!sink.good())
+			return false;
+
+		return write_mesh(sink, points, cells);
+	}
+
+	bool VTPWriter::write_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		const int s = section(ctype);
+		assert(s >= 0);
+		if (s < 0)
+			return false;
+
+		const int64_t n_cell_vertices = cells.cols();
+
+		// Straight from the column-major cells
+		std::array<SectionData, 3> sections;
+		sections[s].n_cells = cells.rows();
+		sections[s].n_connectivity = cells.size();
+		sections[s].connectivity = [&](const int64_t begin, const int64_t end, int64_t *out) {
+			for (int64_t i = begin; i < end; ++i)
+				*out++ = cells(i / n_cell_vertices, i % n_cell_vertices);
+		};
+		sections[s].offsets = [&](const int64_t begin, const int64_t end, int64_t *out) {
+			for (int64_t i = begin; i < end; ++i)
+				*out++ = (i + 1) * n_cell_vertices;
+		};
+
+		return write(sink, points, sections);
+	}
+
+	bool VTPWriter::write_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		std::array<std::vector<int64_t>, 3> connectivity;
+		std::array<std::vector<int64_t>, 3> offsets;
+		// Input index of the cells of every section
+		std::array<std::vector<int64_t>, 3> section_cells;
+
+		for (size_t i = 0; i < cells.size(); ++i)
+		{
+			const CellElement &c = cells[i];
+			const int s = section(c.ctype);
+			assert(s >= 0);
+			if (s < 0)
+				return false;
+
+			connectivity[s].insert(connectivity[s].end(), c.vertices.begin(), c.vertices.end());
+			offsets[s].push_back(connectivity[s].size());
+			section_cells[s].push_back(i);
+		}
+
+		// Mixed input, the cell fields follow the cells to their section
+		auto order = std::make_shared<std::vector<int64_t>>();
+		order->reserve(cells.size());
+		for (int s = 0; s < 3; ++s)
+			order->insert(order->end(), section_cells[s].begin(), section_cells[s].end());
+		if (!std::is_sorted(order->begin(), order->end()))
+			fields_.permute_cell_data(order);
+
+		std::array<SectionData, 3> sections;
+		for (int s = 0; s < 3; ++s)
+		{
+			const std::vector<int64_t> &conn = connectivity[s];
+			const std::vector<int64_t> &offs = offsets[s];
+
+			sections[s].n_cells = offs.size();
+			sections[s].n_connectivity = conn.size();
+			sections[s].connectivity = [&conn](const int64_t begin, const int64_t end, int64_t *out) { std::copy(conn.begin() + begin, conn.begin() + end, out); };
+			sections[s].offsets = [&offs](const int64_t begin, const int64_t end, int64_t *out) { std::copy(offs.begin() + begin, offs.begin() + end, out); };
+		}
+
+		return write(sink, points, sections);
+	}
+
+	bool VTPWriter::write_points(const std::string &path, const Eigen::MatrixXd &points, const bool with_vertices)
+	{
+		FileSink sink(path);
+		if (!sink.good())
+			return false;
+
+		return write_points(sink, points, with_vertices);
+	}
+
+	bool VTPWriter::write_points(Sink &sink, const Eigen::MatrixXd &points, const bool with_vertices)
+	{
+		std::array<SectionData, 3> sections;
+		if (with_vertices)
+		{
+			sections[Verts].n_cells = points.rows();
+			sections[Verts].n_connectivity = points.rows();
+			sections[Verts].connectivity = [](const int64_t begin, const int64_t end, int64_t *out) {
+				for (int64_t i = begin; i < end; ++i)
+					*out++ = i;
+			};
+			sections[Verts].offsets = [](const int64_t begin, const int64_t end, int64_t *out) {
+				for (int64_t i = begin; i < end; ++i)
+					*out++ = i + 1;
+			};
+		}
+
+		return write(sink, points, sections);
+	}
+} // namespace paraviewo
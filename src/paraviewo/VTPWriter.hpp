@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ParaviewWriter.hpp"
+#include "VTKFieldData.hpp"
+
+#include <Eigen/Dense>
+
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Surfaces, curves and point clouds (.vtp): vertices, lines and polygons are stored in their own Verts, Lines and
+	/// Polys sections without a types array. Volume cells are not supported.
+	class VTPWriter : public FieldWriter
+	{
+	public:
+		VTPWriter(bool binary = true);
+
+		/// ctype is Vertex, Line, Triangle, Quadrilateral or Polygon
+		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype);
+		/// Cells are written section by section (vertices, then lines, then polygons), the cell fields (given in the order
+		/// of cells) are regrouped with them
+		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells);
+
+		bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype);
+		bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells);
+
+		/// Particles: one vertex per point, the trivial Verts topology is generated on the fly (or omitted without
+		/// with_vertices, e.g., for the Point Gaussian representation), so the cost is only the points and the fields
+		bool write_points(const std::string &path, const Eigen::MatrixXd &points, const bool with_vertices = true);
+		bool write_points(Sink &sink, const Eigen::MatrixXd &points, const bool with_vertices = true);
+
+		void clear() override;
+
+	protected:
+		void add_scalar_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point) override;
+
+	private:
+		enum Section
+		{
+			Verts = 0,
+			Lines = 1,
+			Polys = 2
+		};
+
+		/// Connectivity and offsets of one section, produced on the fly
+		struct SectionData
+		{
+			int64_t n_cells = 0;
+			int64_t n_connectivity = 0;
+			Int64Generator connectivity;
+			Int64Generator offsets;
+		};
+
+		bool binary_;
+		VTKFieldData fields_;
+
+		static int section(const CellType ctype);
+
+		bool write(Sink &sink, const Eigen::MatrixXd &points, const std::array<SectionData, 3> &sections);
+		void write_section(const std::string &name, const SectionData &data, std::ostream &os);
+	};
+} // namespace paraviewo
@@ -0,0 +1,104 @@
+#include "VTRWriter.hpp"
+
+#include <limits>
+
+namespace paraviewo
+{
+
+	VTRWriter::VTRWriter(bool binary)
+		: binary_(binary), fields_(binary)
+	{
+	}
+
+	void VTRWriter::clear()
+	{
+		fields_.clear();
+	}
+
+	void VTRWriter::add_scalar_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_scalar_field(name, data, true, field_precision(name));
+	}
+
+	void VTRWriter::add_vector_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_vector_field(name, data, true, field_precision(name));
+	}
+
+	void VTRWriter::add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_scalar_field(name, data, false, field_precision(name));
+	}
+
+	void VTRWriter::add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		fields_.add_vector_field(name, data, false, field_precision(name));
+	}
+
+	void VTRWriter::add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point)
+	{
+		fields_.add_generated_field(name, n_rows, n_components, fill, n_threads_, is_point, field_precision(name));
+	}
+
+	void VTRWriter::write_coordinates(const Eigen::VectorXd &coordinates, std::ostream &os)
+	{
+		if (binary_)
+		{
+			base64Layer base64(os);
+
+			os << "<DataArray type=\"Float64\" NumberOfComponents=\"1\" format=\"binary\">\n";
+			const uint64_t size = coordinates.size() * sizeof(double);
+			base64.write(size);
+
+			base64.write(coordinates.data(), coordinates.size());
+			base64.close();
+			os << "\n";
+		}
+		else
+		{
+			os << "<DataArray type=\"Float64\" NumberOfComponents=\"1\" format=\"ascii\">\n";
+			for (int i = 0; i < coordinates.size(); ++i)
+				os << coordinates(i) << "\n";
+		}
+		os << "</DataArray>\n";
+	}
+
+	bool VTRWriter::write_mesh(const std::string &path, const Eigen::VectorXd &x, const Eigen::VectorXd &y, const Eigen::VectorXd &z)
+	{
+		FileSink sink(path);
+		if (!sink.good())
+			return false;
+
+		return write_mesh(sink, x, y, z);
+	}
+
+	bool VTRWriter::write_mesh(Sink &sink, const Eigen::VectorXd &x, const Eigen::VectorXd &y, const Eigen::VectorXd &z)
+	{
+		begin_write();
+		SinkStreamBuf buffer(sink);
+		std::ostream os(&buffer);
+		os.precision(std::numeric_limits<double>::max_digits10);
+
+		const Eigen::VectorXd z_coordinates = z.size() > 0 ? z : Eigen::VectorXd::Zero(1);
+		const std::string extent = vtk_extent(Eigen::Vector3i(x.size(), y.size(), z_coordinates.size()));
+
+		os << "<VTKFile type=\"RectilinearGrid\" version=\"1.0\" header_type=\"UInt64\">\n";
+		os << "<RectilinearGrid WholeExtent=\"" << extent << "\">\n";
+		os << "<Piece Extent=\"" << extent << "\">\n";
+		fields_.write_point_data(os, workspace());
+		fields_.write_cell_data(os, workspace());
+		os << "<Coordinates>\n";
+		write_coordinates(x, os);
+		write_coordinates(y, os);
+		write_coordinates(z_coordinates, os);
+		os << "</Coordinates>\n";
+		os << "</Piece>\n";
+		os << "</RectilinearGrid>\n";
+		os << "</VTKFile>\n";
+
+		os.flush();
+		end_write();
+		clear();
+		return sink.good();
+	}
+} // namespace paraviewo
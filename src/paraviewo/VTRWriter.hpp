@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ParaviewWriter.hpp"
+#include "VTKFieldData.hpp"
+
+#include <Eigen/Dense>
+
+#include <iostream>
+#include <string>
+
+namespace paraviewo
+{
+	/// Rectilinear grids (.vtr), the points are the tensor product of the coordinates x, y, z along each axis.
+	/// Point fields are ordered with x varying fastest, then y, then z.
+	class VTRWriter : public FieldWriter
+	{
+	public:
+		VTRWriter(bool binary = true);
+
+		/// An empty z gives a 2D grid (z = 0)
+		bool write_mesh(const std::string &path, const Eigen::VectorXd &x, const Eigen::VectorXd &y, const Eigen::VectorXd &z);
+		bool write_mesh(Sink &sink, const Eigen::VectorXd &x, const Eigen::VectorXd &y, const Eigen::VectorXd &z);
+
+		void clear() override;
+
+	protected:
+		void add_scalar_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+		void add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
+
+		void add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point) override;
+
+	private:
+		bool binary_;
+		VTKFieldData fields_;
+
+		void write_coordinates(const Eigen::VectorXd &coordinates, std::ostream &os);
+	};
+} // namespace paraviewo
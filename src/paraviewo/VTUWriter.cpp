@@ -1,54 +1,19 @@
 #include "VTUWriter.hpp"
 
+#include "NodeOrdering.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
 namespace paraviewo
 {
 
 	VTUWriter::VTUWriter(bool binary)
-		: binary_(binary)
+		: binary_(binary), fields_(binary)
 	{
 	}
 
-	void VTUWriter::write_point_data(std::ostream &os)
-	{
-		if (current_scalar_point_data_.empty() && current_vector_point_data_.empty())
-			return;
-
-		os << "<PointData ";
-		if (!current_scalar_point_data_.empty())
-			os << "Scalars=\"" << current_scalar_point_data_ << "\" ";
-		if (!current_vector_point_data_.empty())
-			os << "Vectors=\"" << current_vector_point_data_ << "\" ";
-		os << ">\n";
-
-		for (auto it = point_data_.begin(); it != point_data_.end(); ++it)
-		{
-			it->write(os);
-		}
-
-		os << "</PointData>\n";
-	}
-
-	void VTUWriter::write_cell_data(std::ostream &os)
-	{
-		if (current_scalar_cell_data_.empty() && current_vector_cell_data_.empty())
-			return;
-
-		os << "<CellData ";
-		if (!current_scalar_cell_data_.empty())
-			os << "Scalars=\"" << current_scalar_cell_data_ << "\" ";
-		if (!current_vector_cell_data_.empty())
-			os << "Vectors=\"" << current_vector_cell_data_ << "\" ";
-		os << ">\n";
-
-		for (auto it = cell_data_.begin(); it != cell_data_.end(); ++it)
-		{
-			it->write(os);
-		}
-
-		os << "</CellData>\n";
-	}
-
-	void VTUWriter::write_header(const int n_vertices, const int n_elements, std::ostream &os)
+	void VTUWriter::write_header(const int64_t n_vertices, const int64_t n_elements, std::ostream &os)
 	{
 		os << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" header_type=\"UInt64\">\n";
 		os << "<UnstructuredGrid>\n";
@@ -64,96 +29,30 @@ namespace paraviewo
 
 	void VTUWriter::write_points(const Eigen::MatrixXd &points, std::ostream &os)
 	{
-		os << "<Points>\n";
-		if (binary_)
-		{
-
-			Eigen::MatrixXd tmp = points.transpose();
-			if (tmp.rows() != 3)
-			{
-				tmp.conservativeResize(3, tmp.cols());
-				tmp.row(2).setZero();
-			}
-
-			base64Layer base64(os);
-
-			os << "<DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"binary\">\n";
-			const uint64_t size = tmp.size() * sizeof(double);
-			base64.write(size);
-
-			base64.write(tmp.data(), tmp.size());
-			base64.close();
-			os << "\n";
-		}
-		else
-		{
-			os << "<DataArray type=\"Float32\" NumberOfComponents=\"3\" format=\"ascii\">\n";
-
-			for (int d = 0; d < points.rows(); ++d)
-			{
-
-				for (int i = 0; i < points.cols(); ++i)
-				{
-					os << points(d, i);
-					if (i < points.cols() - 1)
-					{
-						os << " ";
-					}
-				}
-
-				if (!(points.cols() == 3))
-					os << " 0";
-
-				os << "\n";
-			}
-		}
-
-		os << "</DataArray>\n";
-		os << "</Points>\n";
+		write_vtk_points(points, binary_, os, workspace());
 	}
 
 	void VTUWriter::write_cells(const Eigen::MatrixXi &cells, const CellType ctype, std::ostream &os)
 	{
-		const int n_cells = cells.rows();
-		const int n_cell_vertices = cells.cols();
+		const int64_t n_cells = cells.rows();
+		const int64_t n_cell_vertices = cells.cols();
 		os << "<Cells>\n";
-		base64Layer base64(os);
-
-		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		if (binary_)
-		{
-			os << "<DataArray type=\"Int64\" Name=\"connectivity\" format=\"binary\" >\n";
-			const uint64_t size = cells.size() * sizeof(int64_t);
-			base64.write(size);
-
-			Eigen::Matrix<int64_t, Eigen::Dynamic, Eigen::Dynamic> tmp = cells.transpose().template cast<int64_t>();
-			base64.write(tmp.data(), tmp.size());
-			base64.close();
-			os << "\n";
-		}
-		else
-		{
-			os << "<DataArray type=\"Int64\" Name=\"connectivity\" format=\"ascii\">\n";
 
-			for (int c = 0; c < n_cells; ++c)
-			{
-				for (int i = 0; i < n_cell_vertices; ++i)
+		// Straight from the column-major cells, block by block, gathering the nodes in the VTK order
+		NodePermutations permutations(node_ordering());
+		const int *perm = permutations.get(ctype, n_cell_vertices);
+		write_vtk_int64_array(
+			"connectivity", cells.size(), [&](const int64_t begin, const int64_t end, int64_t *out) {
+				for (int64_t i = begin; i < end; ++i)
 				{
-					const int64_t v_index = cells(c, i);
-
-					os << v_index;
-					if (i < n_cell_vertices - 1)
-					{
-						os << " ";
-					}
+					const int j = i % n_cell_vertices;
+					*out++ = cells(i / n_cell_vertices, perm ? perm[j] : j);
 				}
-			}
-
-			os << "\n";
-		}
+			},
+			binary_, os, workspace());
 
-		os << "</DataArray>\n";
 		/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		base64Layer base64(os);
 		const int int_tag = paraview_tags::VTKTag(n_cell_vertices, ctype);
 		if (binary_)
 		{
@@ -164,13 +63,13 @@ namespace paraviewo
 		else
 			os << "<DataArray type=\"Int8\" Name=\"types\" format=\"ascii\">\n";
 
-		for (int i = 0; i < n_cells; ++i)
+		for (int64_t i = 0; i < n_cells; ++i)
 		{
 			const int8_t tag = int_tag;
 			if (binary_)
 				base64.write(tag);
 			else
-				os << tag << "\n";
+				os << int_tag << "\n";
 		}
 		if (binary_)
 		{
@@ -180,85 +79,48 @@ namespace paraviewo
 		os << "</DataArray>\n";
 
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		if (binary_)
-		{
-			os << "<DataArray type=\"Int64\" Name=\"offsets\" format=\"binary\">\n";
-			const uint64_t size = n_cells * sizeof(int64_t);
-			base64.write(size);
-		}
-		else
-			os << "<DataArray type=\"Int64\" Name=\"offsets\" format=\"ascii\">\n";
-
-		int64_t acc = n_cell_vertices;
-		for (int i = 0; i < n_cells; ++i)
-		{
-			if (binary_)
-				base64.write(acc);
-			else
-				os << acc << "\n";
-			acc += n_cell_vertices;
-		}
-		if (binary_)
-		{
-			base64.close();
-			os << "\n";
-		}
-
-		os << "</DataArray>\n";
+		write_vtk_int64_array(
+			"offsets", n_cells, [&](const int64_t begin, const int64_t end, int64_t *out) {
+				for (int64_t i = begin; i < end; ++i)
+					*out++ = (i + 1) * n_cell_vertices;
+			},
+			binary_, os, workspace());
 		//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		os << "</Cells>\n";
 	}
 
 	void VTUWriter::write_cells(const std::vector<CellElement> &cells, std::ostream &os)
 	{
-		const int n_cells = cells.size();
+		const int64_t n_cells = cells.size();
 		os << "<Cells>\n";
-		base64Layer base64(os);
-
-		int n_cells_indices = 0;
-		for (const auto &c : cells)
-			n_cells_indices += c.vertices.size();
 
-		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		if (binary_)
-		{
-			os << "<DataArray type=\"Int64\" Name=\"connectivity\" format=\"binary\" >\n";
-			const uint64_t size = n_cells_indices * sizeof(int64_t);
-			base64.write(size);
-
-			Eigen::Matrix<int64_t, Eigen::Dynamic, 1> tmp(n_cells_indices);
-			int index = 0;
-			for (const auto &c : cells)
-			{
-				for (const int i : c.vertices)
-					tmp(index++) = i;
-			}
-			base64.write(tmp.data(), tmp.size());
-			base64.close();
-			os << "\n";
-		}
-		else
-		{
-			os << "<DataArray type=\"Int64\" Name=\"connectivity\" format=\"ascii\">\n";
-
-			for (const auto &c : cells)
-			{
-				for (size_t i = 0; i < c.vertices.size(); ++i)
+		// Offsets (with a leading 0) in the workspace, the connectivity is gathered from the cells block by block
+		Workspace::Scope scope(workspace());
+		int64_t *offsets = workspace().allocate<int64_t>(n_cells + 1);
+		offsets[0] = 0;
+		for (int64_t i = 0; i < n_cells; ++i)
+			offsets[i + 1] = offsets[i] + cells[i].vertices.size();
+
+		NodePermutations permutations(node_ordering());
+		write_vtk_int64_array(
+			"connectivity", offsets[n_cells], [&](const int64_t begin, const int64_t end, int64_t *out) {
+				int64_t c = std::upper_bound(offsets, offsets + n_cells + 1, begin) - offsets - 1;
+				const int *perm = permutations.get(cells[c].ctype, cells[c].vertices.size());
+				for (int64_t i = begin; i < end; ++i)
 				{
-					const int64_t v_index = c.vertices[i];
-
-					os << v_index;
-					if (i < c.vertices.size() - 1)
+					while (i >= offsets[c + 1])
 					{
-						os << " ";
+						++c;
+						perm = permutations.get(cells[c].ctype, cells[c].vertices.size());
 					}
+					const int64_t j = i - offsets[c];
+					*out++ = cells[c].vertices[perm ? perm[j] : j];
 				}
-				os << "\n";
-			}
-		}
+			},
+			binary_, os, workspace());
 
-		os << "</DataArray>\n";
 		/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		base64Layer base64(os);
 		if (binary_)
 		{
 			os << "<DataArray type=\"UInt8\" Name=\"types\" format=\"binary\">\n";
@@ -268,7 +130,7 @@ namespace paraviewo
 		else
 			os << "<DataArray type=\"UInt8\" Name=\"types\" format=\"ascii\">\n";
 
-		for (int i = 0; i < n_cells; ++i)
+		for (int64_t i = 0; i < n_cells; ++i)
 		{
 			const int int_tag = paraview_tags::VTKTag(cells[i].vertices.size(), cells[i].ctype);
 			const uint8_t tag = int_tag;
@@ -286,128 +148,349 @@ namespace paraviewo
 		os << "</DataArray>\n";
 
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		write_vtk_int64_array(
+			"offsets", n_cells, [&](const int64_t begin, const int64_t end, int64_t *out) { std::copy(offsets + begin + 1, offsets + end + 1, out); },
+			binary_, os, workspace());
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		os << "</Cells>\n";
+	}
+
+	void VTUWriter::write_cells(const PolyhedralCells &cells, std::ostream &os)
+	{
+		const int64_t n_cells = cells.n_cells();
+		os << "<Cells>\n";
+
+		Workspace::Scope scope(workspace());
+		const PolyhedronPoints points = polyhedron_points(cells, n_threads_, workspace());
+		write_vtk_int64_array(
+			"connectivity", points.offsets[n_cells], [&](const int64_t begin, const int64_t end, int64_t *out) { std::copy(points.points + begin, points.points + end, out); },
+			binary_, os, workspace());
+
+		/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		base64Layer base64(os);
 		if (binary_)
 		{
-			os << "<DataArray type=\"Int64\" Name=\"offsets\" format=\"binary\">\n";
-			const uint64_t size = n_cells * sizeof(int64_t);
+			os << "<DataArray type=\"UInt8\" Name=\"types\" format=\"binary\">\n";
+			const uint64_t size = n_cells * sizeof(uint8_t);
 			base64.write(size);
 		}
 		else
-			os << "<DataArray type=\"Int64\" Name=\"offsets\" format=\"ascii\">\n";
+			os << "<DataArray type=\"UInt8\" Name=\"types\" format=\"ascii\">\n";
 
-		int64_t acc = 0;
-		for (int i = 0; i < n_cells; ++i)
+		for (int64_t i = 0; i < n_cells; ++i)
 		{
-			acc += cells[i].vertices.size();
+			const int int_tag = paraview_tags::VTKTag(points.offsets[i + 1] - points.offsets[i], CellType::Polyhedron);
+			const uint8_t tag = int_tag;
+
 			if (binary_)
-				base64.write(acc);
+				base64.write(tag);
 			else
-				os << acc << "\n";
+				os << int_tag << "\n";
 		}
 		if (binary_)
 		{
 			base64.close();
 			os << "\n";
 		}
-
 		os << "</DataArray>\n";
-		//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+		write_vtk_int64_array(
+			"offsets", n_cells, [&](const int64_t begin, const int64_t end, int64_t *out) { std::copy(points.offsets + begin + 1, points.offsets + end + 1, out); },
+			binary_, os, workspace());
+
+		////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// Every cell is [n_faces, n_face_vertices, vertices..., n_face_vertices, vertices...], gathered block by block
+		const int64_t *stream = polyhedron_stream_offsets(cells, n_threads_, workspace());
+		write_vtk_int64_array(
+			"faces", stream[n_cells], [&](const int64_t begin, const int64_t end, int64_t *out) {
+				int64_t c = std::upper_bound(stream, stream + n_cells + 1, begin) - stream - 1;
+				int64_t i = stream[c];
+				const auto emit = [&](const int64_t value) {
+					if (i >= begin)
+						*out++ = value;
+					++i;
+				};
+
+				for (; i < end; ++c)
+				{
+					emit(cells.cell_offsets[c + 1] - cells.cell_offsets[c]);
+					for (int64_t k = cells.cell_offsets[c]; k < cells.cell_offsets[c + 1] && i < end; ++k)
+					{
+						const int64_t f = cells.cell_faces[k];
+						const int64_t first = cells.face_offsets[f];
+						const int64_t last = cells.face_offsets[f + 1];
+						// Faces before the block are skipped whole
+						if (i + 1 + last - first <= begin)
+						{
+							i += 1 + last - first;
+							continue;
+						}
+
+						emit(last - first);
+						for (int64_t v = first; v < last && i < end; ++v)
+							emit(cells.face_vertices[v]);
+					}
+				}
+			},
+			binary_, os, workspace());
+
+		write_vtk_int64_array(
+			"faceoffsets", n_cells, [&](const int64_t begin, const int64_t end, int64_t *out) { std::copy(stream + begin + 1, stream + end + 1, out); },
+			binary_, os, workspace());
 		os << "</Cells>\n";
 	}
 
 	void VTUWriter::clear()
 	{
-		point_data_.clear();
-		cell_data_.clear();
+		fields_.clear();
 	}
 
-	void VTUWriter::add_scalar_field(const std::string &name, const Eigen::MatrixXd &data)
+	void VTUWriter::session_field(const std::string &name, const Eigen::MatrixXd &data, const bool is_point)
 	{
-		point_data_.push_back(VTKDataNode<double>(binary_));
-		point_data_.back().initialize(name, "Float64", data);
-		current_scalar_point_data_ = name;
+		// Encoded block by block straight from data
+		VTKDataNode<double> node(binary_);
+		node.initialize(name, "Float64", data.rows(), data.cols(), matrix_generator(data), 1, field_precision(name));
+		session_field(node, is_point);
 	}
 
-	void VTUWriter::add_vector_field(const std::string &name, const Eigen::MatrixXd &data)
+	void VTUWriter::session_field(const VTKDataNode<double> &node, const bool is_point)
 	{
-		point_data_.push_back(VTKDataNode<double>(binary_));
-
-		Eigen::MatrixXd tmp = data;
+		std::ostream &os = *session_os_;
 
-		if (data.cols() == 2)
+		if (is_point)
 		{
-			tmp.conservativeResize(tmp.rows(), 3);
-			tmp.col(2).setZero();
+			if (session_section_ == SessionSection::CellData)
+				throw std::logic_error("Point field added after the cell fields");
+			if (session_section_ == SessionSection::Geometry)
+				os << "<PointData>\n";
+			session_section_ = SessionSection::PointData;
 		}
+		else if (session_section_ != SessionSection::CellData)
+		{
+			if (session_section_ == SessionSection::PointData)
+				os << "</PointData>\n";
+			os << "<CellData>\n";
+			session_section_ = SessionSection::CellData;
+		}
+
+		node.write(os, workspace());
+		os.flush();
+	}
 
-		point_data_.back().initialize(name, "Float64", tmp, tmp.cols());
-		current_vector_point_data_ = name;
+	void VTUWriter::add_scalar_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		if (session_os_)
+			session_field(name, data, true);
+		else
+			fields_.add_scalar_field(name, data, true, field_precision(name));
+	}
+
+	void VTUWriter::add_vector_field(const std::string &name, const Eigen::MatrixXd &data)
+	{
+		if (session_os_)
+			session_field(name, data, true);
+		else
+			fields_.add_vector_field(name, data, true, field_precision(name));
 	}
 
 	void VTUWriter::add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data)
 	{
-		cell_data_.push_back(VTKDataNode<double>(binary_));
-		cell_data_.back().initialize(name, "Float64", data);
-		current_scalar_cell_data_ = name;
+		if (session_os_)
+			session_field(name, data, false);
+		else
+			fields_.add_scalar_field(name, data, false, field_precision(name));
 	}
 
 	void VTUWriter::add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data)
 	{
-		cell_data_.push_back(VTKDataNode<double>(binary_));
-
-		Eigen::MatrixXd tmp = data;
+		if (session_os_)
+			session_field(name, data, false);
+		else
+			fields_.add_vector_field(name, data, false, field_precision(name));
+	}
 
-		if (data.cols() == 2)
+	void VTUWriter::add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point)
+	{
+		if (session_os_)
 		{
-			tmp.conservativeResize(tmp.rows(), 3);
-			tmp.col(2).setZero();
+			VTKDataNode<double> node(binary_);
+			node.initialize(name, "Float64", n_rows, n_components, fill, n_threads_, field_precision(name));
+			session_field(node, is_point);
+			return;
 		}
 
-		cell_data_.back().initialize(name, "Float64", tmp, tmp.cols());
-		current_vector_cell_data_ = name;
+		fields_.add_generated_field(name, n_rows, n_components, fill, n_threads_, is_point, field_precision(name));
 	}
 
 	bool VTUWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
 	{
-		std::ofstream os;
-		os.open(path.c_str());
-		if (!os.good())
-		{
-			os.close();
+		FileSink sink(path);
+		if (!sink.good())
 			return false;
-		}
+
+		return write_mesh(sink, points, cells, ctype);
+	}
+
+	bool VTUWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		FileSink sink(path);
+		if (!sink.good())
+			return false;
+
+		return write_mesh(sink, points, cells);
+	}
+
+	bool VTUWriter::write_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		begin_write();
+		SinkStreamBuf buffer(sink);
+		std::ostream os(&buffer);
 
 		write_header(points.rows(), cells.rows(), os);
 		write_points(points, os);
-		write_point_data(os);
-		write_cell_data(os);
+		fields_.write_point_data(os, workspace());
+		fields_.write_cell_data(os, workspace());
 		write_cells(cells, ctype, os);
 
 		write_footer(os);
-		os.close();
+		os.flush();
+		end_write();
 		clear();
-		return true;
+		return sink.good();
 	}
 
-	bool VTUWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	bool VTUWriter::write_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
 	{
-		std::ofstream os;
-		os.open(path.c_str());
-		if (!os.good())
-		{
-			os.close();
-			return false;
-		}
+		begin_write();
+		SinkStreamBuf buffer(sink);
+		std::ostream os(&buffer);
 
 		write_header(points.rows(), cells.size(), os);
 		write_points(points, os);
-		write_point_data(os);
-		write_cell_data(os);
+		fields_.write_point_data(os, workspace());
+		fields_.write_cell_data(os, workspace());
 		write_cells(cells, os);
 
 		write_footer(os);
-		os.close();
+		os.flush();
+		end_write();
 		clear();
-		return true;
+		return sink.good();
+	}
+
+	bool VTUWriter::write_mesh(const std::string &path, const Eigen::MatrixXd &points, const PolyhedralCells &cells)
+	{
+		FileSink sink(path);
+		if (!sink.good())
+			return false;
+
+		return write_mesh(sink, points, cells);
+	}
+
+	bool VTUWriter::write_mesh(Sink &sink, const Eigen::MatrixXd &points, const PolyhedralCells &cells)
+	{
+		begin_write();
+		SinkStreamBuf buffer(sink);
+		std::ostream os(&buffer);
+
+		write_header(points.rows(), cells.n_cells(), os);
+		write_points(points, os);
+		fields_.write_point_data(os, workspace());
+		fields_.write_cell_data(os, workspace());
+		write_cells(cells, os);
+
+		write_footer(os);
+		os.flush();
+		end_write();
+		clear();
+		return sink.good();
+	}
+
+	bool VTUWriter::start_session(Sink &sink)
+	{
+		end_mesh();
+		begin_write();
+
+		session_sink_ = &sink;
+		session_buffer_ = std::make_unique<SinkStreamBuf>(sink);
+		session_os_ = std::make_unique<std::ostream>(session_buffer_.get());
+		session_section_ = SessionSection::Geometry;
+		return sink.good();
+	}
+
+	bool VTUWriter::begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		auto file = std::make_unique<FileSink>(path);
+		if (!file->good())
+			return false;
+
+		const bool ok = begin_mesh(*file, points, cells, ctype);
+		session_file_ = std::move(file);
+		return ok;
+	}
+
+	bool VTUWriter::begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		auto file = std::make_unique<FileSink>(path);
+		if (!file->good())
+			return false;
+
+		const bool ok = begin_mesh(*file, points, cells);
+		session_file_ = std::move(file);
+		return ok;
+	}
+
+	bool VTUWriter::begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype)
+	{
+		if (!start_session(sink))
+			return false;
+
+		std::ostream &os = *session_os_;
+		write_header(points.rows(), cells.rows(), os);
+		write_points(points, os);
+		write_cells(cells, ctype, os);
+		os.flush();
+		return sink.good();
+	}
+
+	bool VTUWriter::begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells)
+	{
+		if (!start_session(sink))
+			return false;
+
+		std::ostream &os = *session_os_;
+		write_header(points.rows(), cells.size(), os);
+		write_points(points, os);
+		write_cells(cells, os);
+		os.flush();
+		return sink.good();
+	}
+
+	bool VTUWriter::end_mesh()
+	{
+		if (!session_os_)
+			return false;
+
+		std::ostream &os = *session_os_;
+		if (session_section_ == SessionSection::PointData)
+			os << "</PointData>\n";
+		else if (session_section_ == SessionSection::CellData)
+			os << "</CellData>\n";
+
+		write_footer(os);
+		os.flush();
+		end_write();
+
+		bool ok = session_sink_->good();
+		session_os_.reset();
+		session_buffer_.reset();
+		session_sink_ = nullptr;
+		if (session_file_)
+		{
+			session_file_->close();
+			ok = ok && session_file_->good();
+			session_file_.reset();
+		}
+		return ok;
 	}
 } // namespace paraviewo
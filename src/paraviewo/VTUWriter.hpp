@@ -1,78 +1,20 @@
 #pragma once
 
 #include "ParaviewWriter.hpp"
-
-#include "base64Layer.hpp"
+#include "Polyhedra.hpp"
+#include "VTKFieldData.hpp"
 
 #include <Eigen/Dense>
 
 #include <fstream>
 #include <string>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 namespace paraviewo
 {
 
-	template <typename T>
-	class VTKDataNode
-	{
-
-	public:
-		VTKDataNode(bool binary)
-			: binary_(binary)
-		{
-		}
-
-		VTKDataNode(const std::string &name, const double binary, const std::string &numeric_type, const Eigen::MatrixXd &data = Eigen::MatrixXd(), const int n_components = 1)
-			: name_(name), binary_(binary), numeric_type_(numeric_type), data_(binary_ ? data.transpose() : data), n_components_(n_components)
-		{
-		}
-
-		// const inline Eigen::MatrixXd &data() { return data_; }
-
-		void initialize(const std::string &name, const std::string &numeric_type, const Eigen::MatrixXd &data, const int n_components = 1)
-		{
-			name_ = name;
-			numeric_type_ = numeric_type;
-			data_ = binary_ ? data.transpose() : data;
-			n_components_ = n_components;
-		}
-
-		void write(std::ostream &os) const
-		{
-
-			if (binary_)
-			{
-				base64Layer base64(os);
-
-				os << "<DataArray type=\"" << numeric_type_ << "\" Name=\"" << name_ << "\" NumberOfComponents=\"" << n_components_ << "\" format=\"binary\">\n";
-				const uint64_t size = data_.size() * sizeof(T);
-				base64.write(size);
-
-				base64.write(data_.data(), data_.size());
-				base64.close();
-				os << "\n";
-			}
-			else
-			{
-				os << "<DataArray type=\"" << numeric_type_ << "\" Name=\"" << name_ << "\" NumberOfComponents=\"" << n_components_ << "\" format=\"ascii\">\n";
-				os << data_;
-			}
-			os << "</DataArray>\n";
-		}
-
-		inline bool empty() const { return data_.size() <= 0; }
-
-	private:
-		std::string name_;
-		bool binary_;
-		/// Float32/
-		std::string numeric_type_;
-		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> data_;
-		int n_components_;
-	};
-
 	class VTUWriter : public ParaviewWriter
 	{
 	public:
@@ -83,6 +25,19 @@ namespace paraviewo
 		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
 		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
 
+		bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
+		bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
+
+		/// Polyhedral mesh, the faces are written in the faces and faceoffsets arrays
+		bool write_mesh(const std::string &path, const Eigen::MatrixXd &points, const PolyhedralCells &cells);
+		bool write_mesh(Sink &sink, const Eigen::MatrixXd &points, const PolyhedralCells &cells);
+
+		bool begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
+		bool begin_mesh(const std::string &path, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
+		bool begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const Eigen::MatrixXi &cells, const CellType ctype) override;
+		bool begin_mesh(Sink &sink, const Eigen::MatrixXd &points, const std::vector<CellElement> &cells) override;
+		bool end_mesh() override;
+
 		void clear() override;
 
 	protected:
@@ -92,23 +47,34 @@ namespace paraviewo
 		void add_scalar_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
 		void add_vector_cell_field(const std::string &name, const Eigen::MatrixXd &data) override;
 
+		void add_generated_field(const std::string &name, const int64_t n_rows, const int n_components, const FieldGenerator &fill, const bool is_point) override;
+
 	private:
 		bool binary_;
+		VTKFieldData fields_;
 
-		std::vector<VTKDataNode<double>> point_data_;
-		std::string current_scalar_point_data_;
-		std::string current_vector_point_data_;
-
-		std::vector<VTKDataNode<double>> cell_data_;
-		std::string current_scalar_cell_data_;
-		std::string current_vector_cell_data_;
-
-		void write_point_data(std::ostream &os);
-		void write_cell_data(std::ostream &os);
-		void write_header(const int n_vertices, const int n_elements, std::ostream &os);
+		enum class SessionSection
+		{
+			Geometry,
+			PointData,
+			CellData
+		};
+
+		std::unique_ptr<FileSink> session_file_;
+		std::unique_ptr<SinkStreamBuf> session_buffer_;
+		std::unique_ptr<std::ostream> session_os_;
+		Sink *session_sink_ = nullptr;
+		SessionSection session_section_;
+
+		bool start_session(Sink &sink);
+		void session_field(const VTKDataNode<double> &node, const bool is_point);
+		void session_field(const std::string &name, const Eigen::MatrixXd &data, const bool is_point);
+
+		void write_header(const int64_t n_vertices, const int64_t n_elements, std::ostream &os);
 		void write_footer(std::ostream &os);
 		void write_points(const Eigen::MatrixXd &points, std::ostream &os);
 		void write_cells(const Eigen::MatrixXi &cells, const CellType ctype, std::ostream &os);
 		void write_cells(const std::vector<CellElement> &cells, std::ostream &os);
+		void write_cells(const PolyhedralCells &cells, std::ostream &os);
 	};
 } // namespace paraviewo
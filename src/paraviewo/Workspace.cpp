@@ -0,0 +1,60 @@
+#include "Workspace.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace paraviewo
+{
+	namespace
+	{
+		// Smallest block, avoids many tiny blocks while the high-water mark is found
+		const size_t MIN_BLOCK_BYTES = 1 << 16;
+	} // namespace
+
+	void Workspace::add_block(const size_t size)
+	{
+		blocks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+		capacity_ += size;
+		offset_ = 0;
+		++n_allocations_;
+	}
+
+	void *Workspace::allocate_bytes(const size_t size, const size_t alignment)
+	{
+		// Sizes are rounded so that every allocation keeps the alignment of new[]
+		assert(alignment <= alignof(std::max_align_t));
+		const size_t rounded = (size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+		if (rounded == 0)
+			return nullptr;
+
+		if (blocks_.empty() || offset_ + rounded > blocks_.back().size)
+			add_block(std::max(rounded, MIN_BLOCK_BYTES));
+
+		char *result = blocks_.back().data.get() + offset_;
+		offset_ += rounded;
+		used_ += rounded;
+		high_water_mark_ = std::max(high_water_mark_, used_);
+		return result;
+	}
+
+	void Workspace::release(const size_t n_blocks, const size_t offset, const size_t used)
+	{
+		// Blocks added in the scope stay until the next reset, the last one is reused from its start
+		offset_ = blocks_.size() == n_blocks ? offset : 0;
+		used_ = used;
+	}
+
+	void Workspace::reset()
+	{
+		if (blocks_.size() > 1)
+		{
+			// One block large enough for everything used so far
+			blocks_.clear();
+			capacity_ = 0;
+			add_block(high_water_mark_);
+		}
+
+		offset_ = 0;
+		used_ = 0;
+	}
+} // namespace paraviewo
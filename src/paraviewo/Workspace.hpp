@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Scratch memory of the writers: a bump allocator released all at once with reset(). When a write needs more
+	/// than the current block, extra blocks are allocated, and the next reset merges them into a single block of the
+	/// high-water mark, so repeating the same write (e.g., time stepping) does not allocate anymore.
+	class Workspace
+	{
+	public:
+		Workspace() {};
+
+		Workspace(const Workspace &) = delete;
+		void operator=(const Workspace &) = delete;
+
+		/// Uninitialized memory for n values of T, valid until reset()
+		template <typename T>
+		T *allocate(const size_t n)
+		{
+			return static_cast<T *>(allocate_bytes(n * sizeof(T), alignof(T)));
+		}
+
+		/// Releases all the memory handed out, keeping (at least) the largest size used so far
+		void reset();
+
+		/// Gives back the memory allocated during its lifetime, scopes must be nested
+		class Scope
+		{
+		public:
+			Scope(Workspace &workspace)
+				: workspace_(workspace), n_blocks_(workspace.blocks_.size()), offset_(workspace.offset_), used_(workspace.used_)
+			{
+			}
+			~Scope() { workspace_.release(n_blocks_, offset_, used_); }
+
+			Scope(const Scope &) = delete;
+			void operator=(const Scope &) = delete;
+
+		private:
+			Workspace &workspace_;
+			size_t n_blocks_;
+			size_t offset_;
+			size_t used_;
+		};
+
+		/// Number of heap allocations done so far
+		inline size_t n_allocations() const { return n_allocations_; }
+		/// Bytes owned by the workspace
+		inline size_t capacity() const { return capacity_; }
+
+	private:
+		struct Block
+		{
+			std::unique_ptr<char[]> data;
+			size_t size;
+		};
+
+		std::vector<Block> blocks_;
+		/// Offset in the last block
+		size_t offset_ = 0;
+		/// Bytes handed out since the last reset
+		size_t used_ = 0;
+		size_t high_water_mark_ = 0;
+		size_t capacity_ = 0;
+		size_t n_allocations_ = 0;
+
+		void *allocate_bytes(const size_t size, const size_t alignment);
+		void add_block(const size_t size);
+		void release(const size_t n_blocks, const size_t offset, const size_t used);
+	};
+} // namespace paraviewo
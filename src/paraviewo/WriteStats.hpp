@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace paraviewo
+{
+	/// Compression chosen for one array by the adaptive mode
+	struct ArrayCompression
+	{
+		/// Dataset path
+		std::string name;
+		/// Deflate level, 0 if the array is stored uncompressed
+		int level = 0;
+		/// Raw size over compressed size, measured on the sample
+		double ratio = 1;
+		/// Compression throughput of the chosen level on the sample, in MB/s of raw data (0 if not compressed)
+		double mb_per_s = 0;
+	};
+
+	/// Measurements of the last write of a writer
+	struct WriteStats
+	{
+		/// Arrays compressed with the adaptive mode, in the order they were written
+		std::vector<ArrayCompression> arrays;
+		/// Heap allocations of the writer workspace, 0 once the workspace is large enough (e.g., repeated time steps).
+		/// Other allocations are not counted: std::vector temporaries (e.g., of the filters and the mixed cell
+		/// regrouping), field copies, names and the buffers of HDF5 itself.
+		size_t allocations = 0;
+		/// Size of the workspace after the write
+		size_t workspace_bytes = 0;
+
+		inline void clear()
+		{
+			arrays.clear();
+			allocations = 0;
+			workspace_bytes = 0;
+		}
+	};
+} // namespace paraviewo
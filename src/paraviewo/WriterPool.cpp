@@ -0,0 +1,105 @@
+#include "WriterPool.hpp"
+
+#include "HDF5File.hpp"
+
+#include <algorithm>
+
+namespace paraviewo
+{
+	WriterPool::WriterPool(const Factory &factory, const int n_threads, const size_t max_queued)
+		: max_queued_(max_queued > 0 ? max_queued : 2 * std::max(1, n_threads)), running_(0), stop_(false)
+	{
+		for (int t = 0; t < std::max(1, n_threads); ++t)
+			writers_.push_back(factory());
+
+		for (auto &writer : writers_)
+		{
+			ParaviewWriter &w = *writer;
+			workers_.emplace_back([this, &w]() { run(w); });
+		}
+	}
+
+	WriterPool::~WriterPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		not_empty_.notify_all();
+
+		for (auto &worker : workers_)
+			worker.join();
+	}
+
+	std::future<bool> WriterPool::submit(WriteJob job)
+	{
+		// std::function needs a copyable job
+		const auto data = std::make_shared<WriteJob>(std::move(job));
+		return submit([data](ParaviewWriter &writer) {
+			for (const auto &field : data->point_fields)
+				writer.add_field(field.first, field.second);
+			for (const auto &field : data->cell_fields)
+				writer.add_cell_field(field.first, field.second);
+
+			if (data->cell_elements.empty())
+				return writer.write_mesh(data->path, data->points, data->cells, data->ctype);
+			return writer.write_mesh(data->path, data->points, data->cell_elements);
+		});
+	}
+
+	std::future<bool> WriterPool::submit(const Job &job)
+	{
+		std::packaged_task<bool(ParaviewWriter &)> task(job);
+		std::future<bool> result = task.get_future();
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			not_full_.wait(lock, [this]() { return queue_.size() < max_queued_; });
+			queue_.push_back(std::move(task));
+		}
+		not_empty_.notify_one();
+		return result;
+	}
+
+	void WriterPool::wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		idle_.wait(lock, [this]() { return queue_.empty() && running_ == 0; });
+	}
+
+	void WriterPool::run(ParaviewWriter &writer)
+	{
+		const bool serialized = writer.uses_hdf5();
+
+		while (true)
+		{
+			std::packaged_task<bool(ParaviewWriter &)> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				not_empty_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+				if (queue_.empty())
+					return;
+
+				task = std::move(queue_.front());
+				queue_.pop_front();
+				++running_;
+			}
+			not_full_.notify_one();
+
+			// Fields left by a failed job are dropped, exceptions end up in the future
+			writer.clear();
+			if (serialized)
+			{
+				std::lock_guard<std::mutex> lock(hdf5_mutex());
+				task(writer);
+			}
+			else
+				task(writer);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				--running_;
+			}
+			idle_.notify_all();
+		}
+	}
+} // namespace paraviewo
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ParaviewWriter.hpp"
+
+#include <Eigen/Dense>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace paraviewo
+{
+	/// One file written by a WriterPool, the job owns its data so that the caller can reuse its buffers right away
+	struct WriteJob
+	{
+		std::string path;
+		Eigen::MatrixXd points;
+		Eigen::MatrixXi cells;
+		CellType ctype = CellType::Triangle;
+		/// Used instead of cells and ctype when not empty
+		std::vector<CellElement> cell_elements;
+
+		std::vector<std::pair<std::string, Eigen::MatrixXd>> point_fields;
+		std::vector<std::pair<std::string, Eigen::MatrixXd>> cell_fields;
+	};
+
+	/// Writes independent files concurrently (e.g., the members of an ensemble) from jobs submitted by any thread.
+	/// Every worker thread has its own writer, built by the factory, so the state of a writer is never shared.
+	/// The HDF5 library is not thread safe: the jobs of writers using it run under hdf5_mutex(), only the other
+	/// writers really write in parallel. submit blocks while max_queued jobs are pending, which bounds the memory
+	/// held by the queue when the writes cannot keep up.
+	///
+	/// WriterPool pool([]() { return std::make_unique<VTUWriter>(); }, 4);
+	/// std::future<bool> done = pool.submit(std::move(job));
+	class WriterPool
+	{
+	public:
+		using Factory = std::function<std::unique_ptr<ParaviewWriter>()>;
+		/// Custom job, called with the (cleared) writer of the worker
+		using Job = std::function<bool(ParaviewWriter &writer)>;
+
+		/// The factory is called n_threads times from the constructor, max_queued = 0 allows 2 * n_threads pending jobs
+		WriterPool(const Factory &factory, const int n_threads, const size_t max_queued = 0);
+		/// Finishes the pending jobs
+		~WriterPool();
+
+		WriterPool(const WriterPool &) = delete;
+		void operator=(const WriterPool &) = delete;
+
+		/// The future holds the result of write_mesh, or the exception thrown by the writer
+		std::future<bool> submit(WriteJob job);
+		std::future<bool> submit(const Job &job);
+
+		/// Blocks until all the submitted jobs are done
+		void wait();
+
+		inline int n_threads() const { return workers_.size(); }
+
+	private:
+		std::vector<std::unique_ptr<ParaviewWriter>> writers_;
+		std::vector<std::thread> workers_;
+
+		std::deque<std::packaged_task<bool(ParaviewWriter &)>> queue_;
+		size_t max_queued_;
+		size_t running_;
+		bool stop_;
+
+		std::mutex mutex_;
+		std::condition_variable not_empty_;
+		std::condition_variable not_full_;
+		std::condition_variable idle_;
+
+		void run(ParaviewWriter &writer);
+	};
+} // namespace paraviewo
@@ -46,9 +46,9 @@ namespace paraviewo
 		inline void write(const int8_t v) { write(reinterpret_cast<const char *>(&v), sizeof(int8_t)); }
 		inline void write(const uint8_t v) { write(reinterpret_cast<const char *>(&v), sizeof(uint8_t)); }
 
-		inline void write(const int64_t *v, const int n) { write(reinterpret_cast<const char *>(v), n * sizeof(int64_t)); }
-		inline void write(const double *v, const int n) { write(reinterpret_cast<const char *>(v), n * sizeof(double)); }
-		inline void write(const float *v, const int n) { write(reinterpret_cast<const char *>(v), n * sizeof(float)); }
+		inline void write(const int64_t *v, const int64_t n) { write(reinterpret_cast<const char *>(v), n * sizeof(int64_t)); }
+		inline void write(const double *v, const int64_t n) { write(reinterpret_cast<const char *>(v), n * sizeof(double)); }
+		inline void write(const float *v, const int64_t n) { write(reinterpret_cast<const char *>(v), n * sizeof(float)); }
 
 		//- Restart a new encoding sequence.
 		void reset();
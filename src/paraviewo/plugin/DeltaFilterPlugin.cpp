@@ -0,0 +1,14 @@
+// HDF5 plugin of the delta filter (IndexPreconditioning::Delta): readers find it in HDF5_PLUGIN_PATH
+#include <paraviewo/DeltaFilter.hpp>
+
+#include <H5PLextern.h>
+
+H5PL_type_t H5PLget_plugin_type(void)
+{
+	return H5PL_TYPE_FILTER;
+}
+
+const void *H5PLget_plugin_info(void)
+{
+	return paraviewo::delta_filter_class();
+}
@@ -1,10 +1,28 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include <paraviewo/VTUWriter.hpp>
 #include <paraviewo/HDF5VTUWriter.hpp>
+#include <paraviewo/HDF5VTIWriter.hpp>
+#include <paraviewo/HDF5VTPWriter.hpp>
+#include <paraviewo/HDF5CollectionWriter.hpp>
 #include <paraviewo/PVDWriter.hpp>
+#include <paraviewo/OutputGovernor.hpp>
+#include <paraviewo/WriterPool.hpp>
+#include <paraviewo/FilteredWriter.hpp>
+#include <paraviewo/NodeOrdering.hpp>
+#include <paraviewo/Parallel.hpp>
+#include <paraviewo/VTIWriter.hpp>
+#include <paraviewo/VTRWriter.hpp>
+#include <paraviewo/VTPWriter.hpp>
 
 #include <Eigen/Dense>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
 #include <catch2/catch_all.hpp>
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -258,4 +276,1612 @@ TEST_CASE("vtu_writer_vecvec_hdf5", "[utils]")
 {
 	HDF5VTUWriter writer;
 	run_test_vecvec_hdf5(writer, "test_vecvec.vtu");
-}
\ No newline at end of file
+}
+
+TEST_CASE("vtu_writer_memory_sink", "[utils]")
+{
+	Eigen::MatrixXd pts(4, 2);
+	pts << 0, 0, 1, 0, 0, 1, 1, 1;
+	Eigen::MatrixXi tris(2, 3);
+	tris << 0, 1, 2,
+		1, 3, 2;
+	Eigen::MatrixXd v(4, 1);
+	v << 1, 2, 3, 4;
+
+	VTUWriter writer;
+	writer.add_field("test", v);
+	REQUIRE(writer.write_mesh("test_memory_sink.vtu", pts, tris, CellType::Triangle));
+
+	MemorySink memory;
+	writer.add_field("test", v);
+	REQUIRE(writer.write_mesh(memory, pts, tris, CellType::Triangle));
+
+	std::ifstream file("test_memory_sink.vtu", std::ios::binary);
+	const std::string expected((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	REQUIRE(std::string(memory.buffer().begin(), memory.buffer().end()) == expected);
+
+	std::string chunked;
+	CallbackSink callback([&](const char *data, const size_t size) {
+		chunked.append(data, size);
+		return true;
+	},
+						  64);
+	writer.add_field("test", v);
+	REQUIRE(writer.write_mesh(callback, pts, tris, CellType::Triangle));
+	REQUIRE(chunked == expected);
+}
+
+template <typename T>
+std::vector<T> hdf5_read(const std::string &path, const std::string &dataset, const hid_t type)
+{
+	const hid_t file = H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+	const hid_t dset = H5Dopen2(file, dataset.c_str(), H5P_DEFAULT);
+	const hid_t space = H5Dget_space(dset);
+	std::vector<T> data(H5Sget_simple_extent_npoints(space));
+	H5Dread(dset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+	H5Sclose(space);
+	H5Dclose(dset);
+	H5Fclose(file);
+	return data;
+}
+
+TEST_CASE("hdf5_writer_memory_sink", "[utils]")
+{
+	Eigen::MatrixXd pts(4, 2);
+	pts << 0, 0, 1, 0, 0, 1, 1, 1;
+	Eigen::MatrixXi tris(2, 3);
+	tris << 0, 1, 2,
+		1, 3, 2;
+
+	HDF5VTUWriter writer;
+	MemorySink memory;
+	REQUIRE(writer.write_mesh(memory, pts, tris, CellType::Triangle));
+
+	// HDF5 signature
+	REQUIRE(memory.buffer().size() > 8);
+	REQUIRE(std::string(memory.buffer().data() + 1, 3) == "HDF");
+
+	// Same bytes as the same mesh written through a file sink, or staged in memory and written to a path
+	const auto read_file = [](const std::string &path) {
+		std::ifstream file(path, std::ios::binary);
+		return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	};
+	const std::string image(memory.buffer().begin(), memory.buffer().end());
+	{
+		FileSink file("test_hdf5_file_sink.hdf");
+		REQUIRE(writer.write_mesh(file, pts, tris, CellType::Triangle));
+	}
+	REQUIRE(read_file("test_hdf5_file_sink.hdf") == image);
+
+	writer.set_core_staging(true);
+	REQUIRE(writer.write_mesh("test_hdf5_staged_sink.hdf", pts, tris, CellType::Triangle));
+	REQUIRE(read_file("test_hdf5_staged_sink.hdf") == image);
+
+	// The image is written from the memory of the core driver, it must also be complete with paged space and the latest format
+	writer.set_page_size(1 << 12);
+	REQUIRE(writer.write_mesh("test_hdf5_staged_paged.hdf", pts, tris, CellType::Triangle));
+	MemorySink paged;
+	REQUIRE(writer.write_mesh(paged, pts, tris, CellType::Triangle));
+	REQUIRE(std::string(paged.buffer().begin(), paged.buffer().end()) == read_file("test_hdf5_staged_paged.hdf"));
+
+	// HDF5 1.10 stamps the root group of latest format files with the creation time, only the size can be compared
+	writer.set_latest_format(true);
+	REQUIRE(writer.write_mesh("test_hdf5_staged_latest.hdf", pts, tris, CellType::Triangle));
+	{
+		FileSink file("test_hdf5_sink_latest.hdf");
+		REQUIRE(writer.write_mesh(file, pts, tris, CellType::Triangle));
+	}
+	REQUIRE(read_file("test_hdf5_sink_latest.hdf").size() == read_file("test_hdf5_staged_latest.hdf").size());
+	REQUIRE(hdf5_read<int64_t>("test_hdf5_sink_latest.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 1, 2, 1, 3, 2});
+}
+
+TEST_CASE("hdf5_writer_core_staging", "[utils]")
+{
+	HDF5VTUWriter writer;
+	writer.set_core_staging(true);
+	writer.set_page_size(1 << 16);
+	writer.set_latest_format(true);
+	run_test(writer, "test_staged.hdf");
+
+	REQUIRE(H5Fis_hdf5("test_staged.hdf") > 0);
+}
+
+std::vector<hsize_t> hdf5_dims(const std::string &path, const std::string &dataset)
+{
+	const hid_t file = H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+	const hid_t dset = H5Dopen2(file, dataset.c_str(), H5P_DEFAULT);
+	const hid_t space = H5Dget_space(dset);
+	std::vector<hsize_t> dims(H5Sget_simple_extent_ndims(space));
+	H5Sget_simple_extent_dims(space, dims.data(), nullptr);
+	H5Sclose(space);
+	H5Dclose(dset);
+	H5Fclose(file);
+	return dims;
+}
+
+TEST_CASE("hdf5_writer_persistent", "[utils]")
+{
+	Eigen::MatrixXd pts(4, 2);
+	pts << 0, 0, 1, 0, 0, 1, 1, 1;
+	Eigen::MatrixXi tris(2, 3);
+	tris << 0, 1, 2,
+		1, 3, 2;
+
+	HDF5VTUWriter writer;
+	writer.set_persistent(true);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		Eigen::MatrixXd v(4, 1);
+		v.setConstant(i);
+		writer.add_field("test", v);
+		REQUIRE(writer.write_mesh("test_persistent.hdf", pts, tris, CellType::Triangle));
+	}
+
+	// Different shape: the datasets are resized in place
+	Eigen::MatrixXi tri(1, 3);
+	tri << 0, 1, 2;
+	REQUIRE(writer.write_mesh("test_persistent.hdf", pts, tri, CellType::Triangle));
+	REQUIRE(writer.close());
+
+	REQUIRE(hdf5_dims("test_persistent.hdf", "/VTKHDF/Connectivity") == std::vector<hsize_t>{3});
+	REQUIRE(hdf5_dims("test_persistent.hdf", "/VTKHDF/Points") == std::vector<hsize_t>{4, 3});
+
+	// The field was not written in the last step
+	const hid_t file = H5Fopen("test_persistent.hdf", H5F_ACC_RDONLY, H5P_DEFAULT);
+	REQUIRE(H5Lexists(file, "/VTKHDF/PointData/test", H5P_DEFAULT) == 0);
+	H5Fclose(file);
+
+	// The chunks do not depend on the shape of the first write: a mesh growing between steps keeps large chunks
+	const auto points_chunk = [](const std::string &path) {
+		const hid_t file = H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+		const hid_t dset = H5Dopen2(file, "/VTKHDF/Points", H5P_DEFAULT);
+		const hid_t dcpl = H5Dget_create_plist(dset);
+		hsize_t chunk[2] = {0, 0};
+		H5Pget_chunk(dcpl, 2, chunk);
+		H5Pclose(dcpl);
+		H5Dclose(dset);
+		H5Fclose(file);
+		return chunk[0];
+	};
+
+	for (const int n : {1000, 100000})
+	{
+		Eigen::MatrixXd cloud(n, 3);
+		cloud.setRandom();
+		Eigen::MatrixXi vertices(n, 1);
+		for (int i = 0; i < n; ++i)
+			vertices(i) = i;
+		REQUIRE(writer.write_mesh("test_persistent_growing.hdf", cloud, vertices, CellType::Vertex));
+	}
+	REQUIRE(writer.close());
+	REQUIRE(hdf5_dims("test_persistent_growing.hdf", "/VTKHDF/Points") == std::vector<hsize_t>{100000, 3});
+	REQUIRE(points_chunk("test_persistent_growing.hdf") == (1 << 20) / (3 * sizeof(double)));
+}
+
+TEST_CASE("hdf5_writer_zero_copy", "[utils]")
+{
+	const int n = 100000;
+	Eigen::MatrixXd pts(n, 2);
+	pts.setRandom();
+	Eigen::MatrixXi cells(n - 2, 3);
+	for (int i = 0; i < cells.rows(); ++i)
+		cells.row(i) << i, i + 1, i + 2;
+	Eigen::MatrixXd v(n, 2);
+	v.setRandom();
+	v(0, 0) = 1e-20;
+
+	HDF5VTUWriter writer;
+	writer.set_zero_copy(true);
+	writer.add_field("v", v);
+	REQUIRE(writer.write_mesh("test_zero_copy.hdf", pts, cells, CellType::Triangle));
+
+	const auto points = hdf5_read<double>("test_zero_copy.hdf", "/VTKHDF/Points", H5T_NATIVE_DOUBLE);
+	const auto connectivity = hdf5_read<int64_t>("test_zero_copy.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64);
+	const auto offsets = hdf5_read<int64_t>("test_zero_copy.hdf", "/VTKHDF/Offsets", H5T_NATIVE_INT64);
+	const auto field = hdf5_read<double>("test_zero_copy.hdf", "/VTKHDF/PointData/v", H5T_NATIVE_DOUBLE);
+
+	bool same = true;
+	for (int i = 0; i < n; ++i)
+	{
+		same &= points[3 * i] == pts(i, 0) && points[3 * i + 1] == pts(i, 1) && points[3 * i + 2] == 0;
+		same &= field[3 * i + 1] == v(i, 1);
+	}
+	for (int i = 0; i < cells.rows(); ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+			same &= connectivity[3 * i + j] == cells(i, j);
+		same &= offsets[i + 1] == 3 * (i + 1);
+	}
+	REQUIRE(same);
+	REQUIRE(field[0] == 0);
+}
+
+TEST_CASE("session_writer", "[utils]")
+{
+	Eigen::MatrixXd pts(4, 2);
+	pts << 0, 0, 1, 0, 0, 1, 1, 1;
+	Eigen::MatrixXi tris(2, 3);
+	tris << 0, 1, 2,
+		1, 3, 2;
+	Eigen::MatrixXd v(4, 2);
+	v.setRandom();
+	Eigen::MatrixXd v_cell(2, 1);
+	v_cell.setRandom();
+
+	SECTION("vtu")
+	{
+		VTUWriter writer;
+		REQUIRE(writer.begin_mesh("test_session.vtu", pts, tris, CellType::Triangle));
+		writer.add_field("v", v);
+		writer.add_cell_field("c", v_cell);
+		REQUIRE_THROWS(writer.add_field("late", v));
+		REQUIRE(writer.end_mesh());
+
+		std::ifstream file("test_session.vtu");
+		const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		REQUIRE(content.find("</PointData>\n<CellData>") != std::string::npos);
+		REQUIRE(content.find("</CellData>\n</Piece>") != std::string::npos);
+	}
+
+	SECTION("hdf5")
+	{
+		HDF5VTUWriter writer;
+		REQUIRE(writer.begin_mesh("test_session.hdf", pts, tris, CellType::Triangle));
+		writer.add_field("v", v);
+		writer.add_cell_field("c", v_cell);
+		REQUIRE(writer.end_mesh());
+
+		REQUIRE(hdf5_dims("test_session.hdf", "/VTKHDF/PointData/v") == std::vector<hsize_t>{4, 3});
+		REQUIRE(hdf5_dims("test_session.hdf", "/VTKHDF/CellData/c") == std::vector<hsize_t>{2});
+	}
+}
+
+TEST_CASE("lazy_fields", "[utils]")
+{
+	const int n = 50000;
+	Eigen::MatrixXd pts(n, 3);
+	pts.setRandom();
+	Eigen::MatrixXi cells(n - 3, 4);
+	for (int i = 0; i < cells.rows(); ++i)
+		cells.row(i) << i, i + 1, i + 2, i + 3;
+
+	const auto norm = [&pts](const int64_t begin, const int64_t end, double *out) {
+		for (int64_t i = begin; i < end; ++i)
+			*out++ = pts.row(i).norm();
+	};
+	const auto xy = [&pts](const int64_t begin, const int64_t end, double *out) {
+		for (int64_t i = begin; i < end; ++i)
+		{
+			*out++ = pts(i, 0);
+			*out++ = pts(i, 1);
+		}
+	};
+	const Eigen::MatrixXd norm_data = pts.rowwise().norm();
+	const Eigen::MatrixXd xy_data = pts.leftCols(2);
+
+	VTUWriter writer;
+	writer.set_num_threads(4);
+
+	MemorySink expected;
+	writer.add_field("norm", norm_data);
+	writer.add_field("xy", xy_data);
+	REQUIRE(writer.write_mesh(expected, pts, cells, CellType::Tetrahedron));
+
+	MemorySink lazy;
+	writer.add_field("norm", n, 1, norm);
+	writer.add_field("xy", n, 2, xy);
+	REQUIRE(writer.write_mesh(lazy, pts, cells, CellType::Tetrahedron));
+
+	REQUIRE(lazy.buffer() == expected.buffer());
+
+	HDF5VTUWriter hdf5_writer;
+	hdf5_writer.set_num_threads(4);
+	hdf5_writer.add_field("xy", n, 2, xy);
+	REQUIRE(hdf5_writer.write_mesh("test_lazy.hdf", pts, cells, CellType::Tetrahedron));
+
+	const auto field = hdf5_read<double>("test_lazy.hdf", "/VTKHDF/PointData/xy", H5T_NATIVE_DOUBLE);
+	REQUIRE(field.size() == 3 * n);
+	REQUIRE(field[3 * (n - 1) + 1] == pts(n - 1, 1));
+	REQUIRE(field[3 * (n - 1) + 2] == 0);
+}
+
+TEST_CASE("structured_writers", "[utils]")
+{
+	Eigen::MatrixXd v(12, 1);
+	for (int i = 0; i < v.rows(); ++i)
+		v(i) = i;
+	Eigen::MatrixXd v_cell(6, 2);
+	v_cell.setRandom();
+
+	VTIWriter vti(false);
+	vti.add_field("v", v);
+	vti.add_cell_field("c", v_cell);
+	REQUIRE(vti.write_mesh("test_grid.vti", Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0.5, 0.25, 1), Eigen::Vector3i(4, 3, 1)));
+
+	std::ifstream file("test_grid.vti");
+	const std::string vti_content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	REQUIRE(vti_content.find("WholeExtent=\"0 3 0 2 0 0\"") != std::string::npos);
+	REQUIRE(vti_content.find("Spacing=\"0.5 0.25 1\"") != std::string::npos);
+	REQUIRE(vti_content.find("Name=\"c\" NumberOfComponents=\"3\"") != std::string::npos);
+
+	Eigen::VectorXd x(4), y(3);
+	x << 0, 0.1, 0.5, 1;
+	y << 0, 2, 3;
+
+	VTRWriter vtr;
+	MemorySink memory;
+	vtr.add_field("v", v);
+	REQUIRE(vtr.write_mesh(memory, x, y, Eigen::VectorXd()));
+	REQUIRE(vtr.write_mesh("test_grid.vtr", x, y, Eigen::VectorXd()));
+
+	const std::string vtr_content(memory.buffer().begin(), memory.buffer().end());
+	REQUIRE(vtr_content.find("<RectilinearGrid WholeExtent=\"0 3 0 2 0 0\">") != std::string::npos);
+	REQUIRE(vtr_content.find("<PointData") != std::string::npos);
+	REQUIRE(vtr_content.find("<Coordinates>") != std::string::npos);
+}
+
+TEST_CASE("hdf5_image_data", "[utils]")
+{
+	const Eigen::Vector3i n(40, 30, 20);
+	const int n_points = n.prod();
+	const int n_cells = (n.array() - 1).prod();
+
+	const auto index = [](const int64_t begin, const int64_t end, double *out) {
+		for (int64_t i = begin; i < end; ++i)
+			*out++ = i;
+	};
+	Eigen::MatrixXd velocity(n_cells, 2);
+	velocity.setRandom();
+
+	HDF5VTIWriter writer;
+	writer.set_chunk_dims(Eigen::Vector3i(16, 16, 16));
+	writer.add_field("index", n_points, 1, index);
+	writer.add_cell_field("velocity", velocity);
+	REQUIRE(writer.write_mesh("test_image.hdf", Eigen::Vector3d(1, 2, 3), Eigen::Vector3d(0.1, 0.1, 0.2), n));
+
+	REQUIRE(hdf5_dims("test_image.hdf", "/VTKHDF/PointData/index") == std::vector<hsize_t>{20, 30, 40});
+	REQUIRE(hdf5_dims("test_image.hdf", "/VTKHDF/CellData/velocity") == std::vector<hsize_t>{19, 29, 39, 3});
+
+	const hid_t file = H5Fopen("test_image.hdf", H5F_ACC_RDONLY, H5P_DEFAULT);
+	const hid_t dset = H5Dopen2(file, "/VTKHDF/PointData/index", H5P_DEFAULT);
+	const hid_t dcpl = H5Dget_create_plist(dset);
+	hsize_t chunk[3];
+	REQUIRE(H5Pget_chunk(dcpl, 3, chunk) == 3);
+	REQUIRE(chunk[0] == 16);
+	REQUIRE(chunk[2] == 16);
+
+	// Sub-volume read
+	const hsize_t start[3] = {5, 7, 11};
+	const hsize_t count[3] = {1, 1, 1};
+	const hid_t space = H5Dget_space(dset);
+	H5Sselect_hyperslab(space, H5S_SELECT_SET, start, nullptr, count, nullptr);
+	const hid_t mem_space = H5Screate_simple(1, count, nullptr);
+	double value = -1;
+	H5Dread(dset, H5T_NATIVE_DOUBLE, mem_space, space, H5P_DEFAULT, &value);
+	REQUIRE(value == (5 * 30 + 7) * 40 + 11);
+
+	int64_t extent[6];
+	const hid_t attr = H5Aopen_by_name(file, "VTKHDF", "WholeExtent", H5P_DEFAULT, H5P_DEFAULT);
+	H5Aread(attr, H5T_NATIVE_INT64, extent);
+	REQUIRE(extent[1] == 39);
+	REQUIRE(extent[5] == 19);
+
+	H5Aclose(attr);
+	H5Sclose(mem_space);
+	H5Sclose(space);
+	H5Pclose(dcpl);
+	H5Dclose(dset);
+	H5Fclose(file);
+}
+
+TEST_CASE("hdf5_vti_writer_field_size", "[utils]")
+{
+	const Eigen::Vector3i n(5, 4, 1);
+	const Eigen::Vector3d origin(0, 0, 0), spacing(1, 1, 1);
+
+	// A 2D grid still has one layer of cells
+	HDF5VTIWriter writer;
+	writer.add_field("u", Eigen::MatrixXd::Ones(20, 1));
+	writer.add_cell_field("p", Eigen::MatrixXd::Ones(12, 1));
+	REQUIRE(writer.write_mesh("test_image_size.hdf", origin, spacing, n));
+
+	// Fields of the wrong size are rejected before anything is written
+	std::remove("test_image_bad_size.hdf");
+	writer.add_field("u", Eigen::MatrixXd::Ones(19, 1));
+	REQUIRE(!writer.write_mesh("test_image_bad_size.hdf", origin, spacing, n));
+	REQUIRE(!std::ifstream("test_image_bad_size.hdf").good());
+	writer.clear();
+
+	const auto constant = [](const int64_t begin, const int64_t end, double *out) { std::fill(out, out + (end - begin), 1.0); };
+	writer.add_cell_field("p", 20, 1, constant);
+	MemorySink memory;
+	REQUIRE(!writer.write_mesh(memory, origin, spacing, n));
+	REQUIRE(memory.buffer().empty());
+	writer.clear();
+
+	REQUIRE(!writer.write_mesh(memory, origin, spacing, Eigen::Vector3i(5, 0, 1)));
+}
+
+TEST_CASE("vtp_writer", "[utils]")
+{
+	Eigen::MatrixXd pts(4, 2);
+	pts << 0, 0, 1, 0, 0, 1, 1, 1;
+	Eigen::MatrixXi tris(2, 3);
+	tris << 0, 1, 2,
+		1, 3, 2;
+	Eigen::MatrixXd v(4, 1);
+	v << 1, 2, 3, 4;
+
+	VTPWriter writer;
+	writer.add_field("test", v);
+	REQUIRE(writer.write_mesh("test_surface.vtp", pts, tris, CellType::Triangle));
+
+	std::vector<CellElement> cells(3);
+	cells[0].vertices = {0, 1, 3, 2};
+	cells[0].ctype = CellType::Quadrilateral;
+	cells[1].vertices = {0, 3};
+	cells[1].ctype = CellType::Line;
+	cells[2].vertices = {1};
+	cells[2].ctype = CellType::Vertex;
+
+	VTPWriter ascii(false);
+	MemorySink memory;
+	REQUIRE(ascii.write_mesh(memory, pts, cells));
+
+	const std::string content(memory.buffer().begin(), memory.buffer().end());
+	REQUIRE(content.find("NumberOfVerts=\"1\" NumberOfLines=\"1\" NumberOfStrips=\"0\" NumberOfPolys=\"1\"") != std::string::npos);
+	REQUIRE(content.find("<Lines>\n<DataArray type=\"Int64\" Name=\"connectivity\" format=\"ascii\">\n0\n3\n</DataArray>\n<DataArray type=\"Int64\" Name=\"offsets\" format=\"ascii\">\n2\n</DataArray>") != std::string::npos);
+	REQUIRE(content.find("types") == std::string::npos);
+}
+
+TEST_CASE("vtp_mixed_cell_fields", "[utils]")
+{
+	Eigen::MatrixXd pts(4, 2);
+	pts << 0, 0, 1, 0, 0, 1, 1, 1;
+
+	// Triangles and lines interleaved, the lines are written first
+	std::vector<CellElement> cells(4);
+	cells[0].vertices = {0, 1, 2};
+	cells[0].ctype = CellType::Triangle;
+	cells[1].vertices = {0, 1};
+	cells[1].ctype = CellType::Line;
+	cells[2].vertices = {1, 3, 2};
+	cells[2].ctype = CellType::Triangle;
+	cells[3].vertices = {2, 3};
+	cells[3].ctype = CellType::Line;
+
+	Eigen::MatrixXd id(4, 1);
+	id << 0, 1, 2, 3;
+
+	VTPWriter ascii(false);
+	ascii.add_cell_field("id", id);
+	ascii.add_cell_field("lazy_id", 4, 1, [](const int64_t begin, const int64_t end, double *out) {
+		for (int64_t i = begin; i < end; ++i)
+			*out++ = 10 + i;
+	});
+	MemorySink memory;
+	REQUIRE(ascii.write_mesh(memory, pts, cells));
+
+	const std::string content(memory.buffer().begin(), memory.buffer().end());
+	REQUIRE(content.find("Name=\"id\" NumberOfComponents=\"1\" format=\"ascii\">\n1\n3\n0\n2</DataArray>") != std::string::npos);
+	REQUIRE(content.find("Name=\"lazy_id\" NumberOfComponents=\"1\" format=\"ascii\">\n11\n13\n10\n12\n</DataArray>") != std::string::npos);
+
+	// Binary fields are regrouped the same way: the lines alone give the first half of the field
+	std::vector<CellElement> grouped = {cells[1], cells[3], cells[0], cells[2]};
+	Eigen::MatrixXd grouped_id(4, 1);
+	grouped_id << 1, 3, 0, 2;
+
+	VTPWriter writer;
+	MemorySink mixed, expected;
+	writer.add_cell_field("id", id);
+	REQUIRE(writer.write_mesh(mixed, pts, cells));
+	writer.add_cell_field("id", grouped_id);
+	REQUIRE(writer.write_mesh(expected, pts, grouped));
+	REQUIRE(mixed.buffer() == expected.buffer());
+}
+
+TEST_CASE("particles", "[utils]")
+{
+	const int n = 100000;
+	Eigen::MatrixXd pts(n, 3);
+	pts.setRandom();
+	Eigen::MatrixXd mass(n, 1);
+	mass.setRandom();
+
+	Eigen::MatrixXi vertices(n, 1);
+	for (int i = 0; i < n; ++i)
+		vertices(i) = i;
+
+	VTPWriter writer;
+	MemorySink explicit_topology;
+	writer.add_field("mass", mass);
+	REQUIRE(writer.write_mesh(explicit_topology, pts, vertices, CellType::Vertex));
+
+	MemorySink implicit_topology;
+	writer.add_field("mass", mass);
+	REQUIRE(writer.write_points(implicit_topology, pts));
+	REQUIRE(implicit_topology.buffer() == explicit_topology.buffer());
+
+	HDF5VTPWriter hdf5_writer;
+	hdf5_writer.add_field("mass", mass);
+	REQUIRE(hdf5_writer.write_points("test_particles.hdf", pts));
+
+	REQUIRE(hdf5_dims("test_particles.hdf", "/VTKHDF/Points") == std::vector<hsize_t>{n, 3});
+	REQUIRE(hdf5_dims("test_particles.hdf", "/VTKHDF/PointData/mass") == std::vector<hsize_t>{n});
+	REQUIRE(hdf5_dims("test_particles.hdf", "/VTKHDF/Lines/Offsets") == std::vector<hsize_t>{1});
+
+	const auto offsets = hdf5_read<int64_t>("test_particles.hdf", "/VTKHDF/Vertices/Offsets", H5T_NATIVE_INT64);
+	REQUIRE(offsets.size() == n + 1);
+	REQUIRE(offsets.back() == n);
+	const auto connectivity = hdf5_read<int64_t>("test_particles.hdf", "/VTKHDF/Vertices/Connectivity", H5T_NATIVE_INT64);
+	REQUIRE(connectivity[n - 1] == n - 1);
+
+	REQUIRE(hdf5_writer.write_points("test_particles_no_vertices.hdf", pts, false));
+	REQUIRE(hdf5_dims("test_particles_no_vertices.hdf", "/VTKHDF/Vertices/Connectivity") == std::vector<hsize_t>{0});
+}
+
+TEST_CASE("boundary_extraction", "[utils]")
+{
+	// Two hexahedra side by side and an inner point that is not on the boundary
+	Eigen::MatrixXd pts(13, 3);
+	pts << 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0,
+		0, 0, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1,
+		2, 0, 0, 2, 1, 0, 2, 0, 1, 2, 1, 1,
+		0.5, 0.5, 0.5;
+	Eigen::MatrixXi hexes(2, 8);
+	hexes << 0, 1, 2, 3, 4, 5, 6, 7,
+		1, 8, 9, 2, 5, 10, 11, 6;
+
+	FilteredMesh boundary;
+	extract_boundary(pts, CellsView(hexes, CellType::Hexahedron), 4, boundary);
+	REQUIRE(boundary.n_cells() == 10);
+	REQUIRE(boundary.points.rows() == 12);
+	REQUIRE(boundary.uniform());
+	REQUIRE(boundary.types[0] == CellType::Quadrilateral);
+	REQUIRE(std::count(boundary.cell_map.begin(), boundary.cell_map.end(), 1) == 5);
+
+	// Quadratic tetrahedron
+	Eigen::MatrixXd tet_pts(10, 3);
+	tet_pts << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1,
+		0.5, 0, 0, 0.5, 0.5, 0, 0, 0.5, 0, 0, 0, 0.5, 0.5, 0, 0.5, 0, 0.5, 0.5;
+	Eigen::MatrixXi tet(1, 10);
+	tet << 0, 1, 2, 3, 4, 5, 6, 7, 8, 9;
+	extract_boundary(tet_pts, CellsView(tet, CellType::Tetrahedron), 1, boundary);
+	REQUIRE(boundary.n_cells() == 4);
+	REQUIRE(boundary.cell_matrix().cols() == 6);
+
+	// Lagrange hex27 on the unit cube: every node of a boundary face lies in the plane of its corners
+	const std::vector<std::array<int, 2>> edges = {{0, 1}, {1, 2}, {3, 2}, {0, 3}, {4, 5}, {5, 6}, {7, 6}, {4, 7}, {0, 4}, {1, 5}, {3, 7}, {2, 6}};
+	Eigen::MatrixXd hex_pts(27, 3);
+	hex_pts.topRows(8) = pts.topRows(8);
+	for (int e = 0; e < 12; ++e)
+		hex_pts.row(8 + e) = 0.5 * (pts.row(edges[e][0]) + pts.row(edges[e][1]));
+	hex_pts.bottomRows(7) << 0, 0.5, 0.5, 1, 0.5, 0.5, 0.5, 0, 0.5, 0.5, 1, 0.5, 0.5, 0.5, 0, 0.5, 0.5, 1, 0.5, 0.5, 0.5;
+	Eigen::MatrixXi hex27(1, 27);
+	for (int j = 0; j < 27; ++j)
+		hex27(0, j) = j;
+	extract_boundary(hex_pts, CellsView(hex27, CellType::Hexahedron), 1, boundary);
+	REQUIRE(boundary.n_cells() == 6);
+	const Eigen::MatrixXi faces = boundary.cell_matrix();
+	REQUIRE(faces.cols() == 9);
+	for (int f = 0; f < 6; ++f)
+	{
+		int axis = -1;
+		for (int d = 0; d < 3; ++d)
+		{
+			bool constant = true;
+			for (int k = 1; k < 4; ++k)
+				constant = constant && boundary.points(faces(f, k), d) == boundary.points(faces(f, 0), d);
+			if (constant)
+				axis = d;
+		}
+		REQUIRE(axis >= 0);
+		for (int k = 4; k < 9; ++k)
+			REQUIRE(boundary.points(faces(f, k), axis) == boundary.points(faces(f, 0), axis));
+	}
+
+	// Through a writer, the cell field follows the faces
+	Eigen::MatrixXd cell_id(2, 1);
+	cell_id << 10, 20;
+	Eigen::MatrixXd x = pts.col(0);
+
+	VTUWriter vtu(false);
+	FilteredWriter writer(vtu);
+	writer.set_boundary_only(true);
+	writer.set_num_threads(2);
+	writer.add_field("x", x);
+	writer.add_cell_field("id", cell_id);
+	MemorySink memory;
+	REQUIRE(writer.write_mesh(memory, pts, hexes, CellType::Hexahedron));
+
+	const std::string content(memory.buffer().begin(), memory.buffer().end());
+	REQUIRE(content.find("NumberOfPoints=\"12\" NumberOfCells=\"10\"") != std::string::npos);
+	REQUIRE(content.find("10\n10\n10\n10\n10\n20\n20\n20\n20\n20") != std::string::npos);
+}
+
+TEST_CASE("clipping", "[utils]")
+{
+	// 10 x 10 grid of quads
+	const int n = 11;
+	Eigen::MatrixXd pts(n * n, 2);
+	for (int j = 0; j < n; ++j)
+		for (int i = 0; i < n; ++i)
+			pts.row(j * n + i) << i, j;
+	Eigen::MatrixXi quads((n - 1) * (n - 1), 4);
+	for (int j = 0; j < n - 1; ++j)
+		for (int i = 0; i < n - 1; ++i)
+			quads.row(j * (n - 1) + i) << j * n + i, j * n + i + 1, (j + 1) * n + i + 1, (j + 1) * n + i;
+
+	const CellsView cells(quads, CellType::Quadrilateral);
+	FilteredMesh clipped;
+	select_cells(pts, cells, box_selector(pts, cells, Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(3, 2, 0)), 4, clipped);
+	REQUIRE(clipped.n_cells() == 6);
+	REQUIRE(clipped.points.rows() == 12);
+	REQUIRE(clipped.cell_map == std::vector<int64_t>{0, 1, 2, 10, 11, 12});
+	REQUIRE(clipped.points.row(clipped.connectivity[2]) == pts.row(quads(0, 2)));
+
+	// Large enough for the parallel passes
+	Eigen::MatrixXi many(100000, 4);
+	for (int c = 0; c < many.rows(); ++c)
+		many.row(c) = quads.row(c % quads.rows());
+	select_cells(pts, CellsView(many, CellType::Quadrilateral), [](const int64_t c) { return c % 100 == 37; }, 8, clipped);
+	REQUIRE(clipped.n_cells() == 1000);
+	REQUIRE(clipped.points.rows() == 4);
+
+	// Point and cell fields restricted through the writer
+	Eigen::MatrixXd x = pts.col(0);
+	Eigen::MatrixXd id(quads.rows(), 1);
+	for (int c = 0; c < id.rows(); ++c)
+		id(c) = c;
+
+	HDF5VTUWriter hdf5;
+	FilteredWriter writer(hdf5);
+	writer.set_clip_box(Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(3, 2, 0));
+	writer.set_cell_selection([](const int64_t c) { return c != 1; });
+	writer.add_field("x", x);
+	writer.add_cell_field("id", id);
+	REQUIRE(writer.write_mesh("test_clip.hdf", pts, quads, CellType::Quadrilateral));
+
+	REQUIRE(hdf5_read<double>("test_clip.hdf", "/VTKHDF/CellData/id", H5T_NATIVE_DOUBLE) == std::vector<double>{0, 2, 10, 11, 12});
+	REQUIRE(hdf5_dims("test_clip.hdf", "/VTKHDF/PointData/x") == std::vector<hsize_t>{12});
+}
+
+TEST_CASE("reordering", "[utils]")
+{
+	// 30 x 30 grid of quads with shuffled points
+	const int n = 31;
+	std::vector<int> shuffle(n * n);
+	for (int i = 0; i < n * n; ++i)
+		shuffle[i] = (i * 577) % (n * n);
+
+	Eigen::MatrixXd pts(n * n, 2);
+	for (int j = 0; j < n; ++j)
+		for (int i = 0; i < n; ++i)
+			pts.row(shuffle[j * n + i]) << i, j;
+	Eigen::MatrixXi quads((n - 1) * (n - 1), 4);
+	for (int j = 0; j < n - 1; ++j)
+		for (int i = 0; i < n - 1; ++i)
+			quads.row(j * (n - 1) + i) << shuffle[j * n + i], shuffle[j * n + i + 1], shuffle[(j + 1) * n + i + 1], shuffle[(j + 1) * n + i];
+
+	const auto spread = [](const std::vector<int> &connectivity, const std::vector<int64_t> &offsets) {
+		int64_t total = 0;
+		for (size_t c = 0; c + 1 < offsets.size(); ++c)
+			for (int64_t k = offsets[c]; k + 1 < offsets[c + 1]; ++k)
+				total += std::abs(connectivity[k + 1] - connectivity[k]);
+		return total;
+	};
+
+	const CellsView cells(quads, CellType::Quadrilateral);
+	FilteredMesh identity;
+	select_cells(pts, cells, [](const int64_t) { return true; }, 1, identity);
+	const int64_t input_spread = spread(identity.connectivity, identity.offsets);
+
+	for (const Reordering method : {Reordering::Morton, Reordering::Hilbert, Reordering::RCM})
+	{
+		std::vector<int64_t> point_order, cell_order;
+		compute_reordering(pts, cells, method, 4, point_order, cell_order);
+
+		FilteredMesh reordered;
+		reorder(pts, cells, point_order, cell_order, 4, reordered);
+		REQUIRE(reordered.points.rows() == pts.rows());
+		REQUIRE(reordered.n_cells() == quads.rows());
+
+		bool consistent = true;
+		for (int64_t c = 0; c < reordered.n_cells(); ++c)
+			for (int j = 0; j < 4; ++j)
+				consistent = consistent && reordered.points.row(reordered.connectivity[4 * c + j]) == pts.row(quads(reordered.cell_map[c], j));
+		REQUIRE(consistent);
+		REQUIRE(spread(reordered.connectivity, reordered.offsets) * 5 < input_spread);
+	}
+
+	Eigen::MatrixXd id(quads.rows(), 1);
+	for (int c = 0; c < id.rows(); ++c)
+		id(c) = c;
+
+	HDF5VTUWriter hdf5;
+	FilteredWriter writer(hdf5);
+	writer.set_reordering(Reordering::Hilbert, true);
+	for (int step = 0; step < 2; ++step)
+	{
+		writer.add_cell_field("id", id);
+		REQUIRE(writer.write_mesh("test_reordered.hdf", pts, quads, CellType::Quadrilateral));
+
+		const auto written_id = hdf5_read<double>("test_reordered.hdf", "/VTKHDF/CellData/id", H5T_NATIVE_DOUBLE);
+		const auto connectivity = hdf5_read<int64_t>("test_reordered.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64);
+		const auto points = hdf5_read<double>("test_reordered.hdf", "/VTKHDF/Points", H5T_NATIVE_DOUBLE);
+		const int c = 100;
+		const int input = written_id[c];
+		REQUIRE(points[3 * connectivity[4 * c]] == pts(quads(input, 0), 0));
+		REQUIRE(points[3 * connectivity[4 * c] + 1] == pts(quads(input, 0), 1));
+	}
+}
+
+hsize_t hdf5_storage_size(const std::string &path, const std::string &dataset)
+{
+	const hid_t file = H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+	const hid_t dset = H5Dopen2(file, dataset.c_str(), H5P_DEFAULT);
+	const hsize_t size = H5Dget_storage_size(dset);
+	H5Dclose(dset);
+	H5Fclose(file);
+	return size;
+}
+
+std::vector<H5Z_filter_t> hdf5_filters(const std::string &path, const std::string &dataset)
+{
+	const hid_t file = H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+	const hid_t dset = H5Dopen2(file, dataset.c_str(), H5P_DEFAULT);
+	const hid_t dcpl = H5Dget_create_plist(dset);
+	std::vector<H5Z_filter_t> filters;
+	for (int i = 0; i < H5Pget_nfilters(dcpl); ++i)
+	{
+		unsigned int flags, config;
+		size_t n_values = 0;
+		filters.push_back(H5Pget_filter2(dcpl, i, &flags, &n_values, nullptr, 0, nullptr, &config));
+	}
+	H5Pclose(dcpl);
+	H5Dclose(dset);
+	H5Fclose(file);
+	return filters;
+}
+
+TEST_CASE("hdf5_index_preconditioning", "[utils]")
+{
+	// Structured hexahedral mesh, connectivity grows with the cell index
+	const int n = 40;
+	Eigen::MatrixXd pts(n * n * n, 3);
+	for (int k = 0; k < n; ++k)
+		for (int j = 0; j < n; ++j)
+			for (int i = 0; i < n; ++i)
+				pts.row((k * n + j) * n + i) << i, j, k;
+	Eigen::MatrixXi hexes((n - 1) * (n - 1) * (n - 1), 8);
+	int c = 0;
+	for (int k = 0; k < n - 1; ++k)
+		for (int j = 0; j < n - 1; ++j)
+			for (int i = 0; i < n - 1; ++i)
+			{
+				const int v = (k * n + j) * n + i;
+				hexes.row(c++) << v, v + 1, v + n + 1, v + n, v + n * n, v + n * n + 1, v + n * n + n + 1, v + n * n + n;
+			}
+
+	HDF5VTUWriter writer;
+	REQUIRE(writer.write_mesh("test_index_none.hdf", pts, hexes, CellType::Hexahedron));
+	writer.set_index_preconditioning(IndexPreconditioning::ScaleOffset);
+	REQUIRE(writer.write_mesh("test_index_scaleoffset.hdf", pts, hexes, CellType::Hexahedron));
+	writer.set_index_preconditioning(IndexPreconditioning::Delta);
+	REQUIRE(writer.write_mesh("test_index_delta.hdf", pts, hexes, CellType::Hexahedron));
+
+	const hsize_t none = hdf5_storage_size("test_index_none.hdf", "/VTKHDF/Connectivity");
+	// Scale-offset packs the 16-bit indices, deflate gains little on packed bits
+	REQUIRE(hdf5_storage_size("test_index_scaleoffset.hdf", "/VTKHDF/Connectivity") * 3 < hexes.size() * sizeof(int64_t));
+	REQUIRE(hdf5_storage_size("test_index_delta.hdf", "/VTKHDF/Connectivity") < none);
+	REQUIRE(hdf5_storage_size("test_index_delta.hdf", "/VTKHDF/Offsets") * 2 < hdf5_storage_size("test_index_none.hdf", "/VTKHDF/Offsets"));
+
+	const auto expected = hdf5_read<int64_t>("test_index_none.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64);
+	REQUIRE(hdf5_read<int64_t>("test_index_scaleoffset.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64) == expected);
+	REQUIRE(hdf5_read<int64_t>("test_index_delta.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64) == expected);
+	REQUIRE(hdf5_read<int64_t>("test_index_delta.hdf", "/VTKHDF/Offsets", H5T_NATIVE_INT64) == hdf5_read<int64_t>("test_index_none.hdf", "/VTKHDF/Offsets", H5T_NATIVE_INT64));
+
+	const auto has_delta = [](const std::vector<H5Z_filter_t> &filters) {
+		return std::find(filters.begin(), filters.end(), DELTA_FILTER_ID) != filters.end();
+	};
+	REQUIRE(has_delta(hdf5_filters("test_index_delta.hdf", "/VTKHDF/Connectivity")));
+
+	// Another filter registered with the same identifier is not used, the index arrays are written without delta coding
+	static const H5Z_class2_t foreign = {
+		H5Z_CLASS_T_VERS,
+		DELTA_FILTER_ID,
+		1, 1,
+		"foreign",
+		nullptr,
+		nullptr,
+		[](unsigned int, size_t, const unsigned int[], size_t nbytes, size_t *, void **) -> size_t { return nbytes; }};
+	REQUIRE(H5Zunregister(DELTA_FILTER_ID) >= 0);
+	REQUIRE(H5Zregister(&foreign) >= 0);
+	REQUIRE(!register_delta_filter());
+	REQUIRE(writer.write_mesh("test_index_foreign.hdf", pts, hexes, CellType::Hexahedron));
+	REQUIRE(!has_delta(hdf5_filters("test_index_foreign.hdf", "/VTKHDF/Connectivity")));
+	REQUIRE(hdf5_read<int64_t>("test_index_foreign.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64) == expected);
+
+	REQUIRE(H5Zunregister(DELTA_FILTER_ID) >= 0);
+	REQUIRE(register_delta_filter());
+	REQUIRE(register_delta_filter());
+}
+
+TEST_CASE("field_precision", "[utils]")
+{
+	// Smooth field with noise in the low bits, as typical FE results
+	const int n = 100000;
+	Eigen::MatrixXd pts = Eigen::MatrixXd::Random(n, 3);
+	Eigen::MatrixXd values(n, 1);
+	for (int i = 0; i < n; ++i)
+		values(i) = std::sin(i * 1e-3) * 100 + 1e-9 * std::cos(i * 7.1);
+
+	FieldPrecision bits;
+	bits.mantissa_bits = 12;
+	std::vector<double> rounded(values.data(), values.data() + n);
+	quantize_values(rounded.data(), n, bits);
+	double max_relative = 0;
+	for (int i = 0; i < n; ++i)
+		max_relative = std::max(max_relative, std::abs(rounded[i] - values(i)) / std::abs(values(i)));
+	REQUIRE(max_relative <= std::ldexp(1.0, -13));
+
+	FieldPrecision absolute;
+	absolute.absolute_error = 1e-3;
+	rounded.assign(values.data(), values.data() + n);
+	quantize_values(rounded.data(), n, absolute);
+	REQUIRE((Eigen::Map<Eigen::VectorXd>(rounded.data(), n) - values).cwiseAbs().maxCoeff() <= 0.5e-3);
+
+	// NaN and infinities go through unchanged, whatever their sign and payload
+	std::vector<double> special = {std::numeric_limits<double>::quiet_NaN(), -std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::signaling_NaN(), std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+	const std::vector<double> original = special;
+	FieldPrecision no_mantissa;
+	no_mantissa.mantissa_bits = 0;
+	quantize_values(special.data(), special.size(), no_mantissa);
+	REQUIRE(std::memcmp(special.data(), original.data(), special.size() * sizeof(double)) == 0);
+	quantize_values(special.data(), special.size(), absolute);
+	for (size_t i = 0; i < special.size(); ++i)
+		REQUIRE((std::isnan(special[i]) ? std::isnan(original[i]) : special[i] == original[i]));
+
+	Eigen::MatrixXi vertices(n, 1);
+	for (int i = 0; i < n; ++i)
+		vertices(i) = i;
+
+	HDF5VTUWriter writer;
+	writer.add_field("u", values);
+	REQUIRE(writer.write_mesh("test_precision_full.hdf", pts, vertices, CellType::Vertex));
+	writer.clear();
+
+	writer.set_field_precision("u", bits);
+	writer.add_field("u", values);
+	REQUIRE(writer.write_mesh("test_precision_bits.hdf", pts, vertices, CellType::Vertex));
+
+	REQUIRE(hdf5_storage_size("test_precision_bits.hdf", "/VTKHDF/PointData/u") * 2 < hdf5_storage_size("test_precision_full.hdf", "/VTKHDF/PointData/u"));
+	std::vector<double> expected(values.data(), values.data() + n);
+	quantize_values(expected.data(), n, bits);
+	REQUIRE(hdf5_read<double>("test_precision_bits.hdf", "/VTKHDF/PointData/u", H5T_NATIVE_DOUBLE) == expected);
+}
+
+TEST_CASE("adaptive_compression", "[utils]")
+{
+	const int n = 200000;
+	Eigen::MatrixXd pts = Eigen::MatrixXd::Random(n, 3);
+	Eigen::MatrixXi vertices(n, 1);
+	Eigen::MatrixXd smooth(n, 1);
+	for (int i = 0; i < n; ++i)
+	{
+		vertices(i) = i;
+		smooth(i) = i % 1000;
+	}
+	const Eigen::MatrixXd noise = Eigen::MatrixXd::Random(n, 1);
+
+	HDF5VTUWriter writer;
+	writer.set_adaptive_compression(1);
+	writer.add_field("smooth", smooth);
+	writer.add_field("noise", noise);
+	REQUIRE(writer.write_mesh("test_adaptive.hdf", pts, vertices, CellType::Vertex));
+
+	const WriteStats &stats = writer.last_write_stats();
+	REQUIRE(stats.arrays.size() == 2);
+	REQUIRE(stats.arrays[0].name == "/VTKHDF/PointData/smooth");
+	REQUIRE(stats.arrays[0].level > 0);
+	REQUIRE(stats.arrays[0].ratio > stats.arrays[1].ratio);
+	REQUIRE(hdf5_read<double>("test_adaptive.hdf", "/VTKHDF/PointData/noise", H5T_NATIVE_DOUBLE) == std::vector<double>(noise.data(), noise.data() + n));
+
+	// Unreachable throughput, nothing is compressed
+	writer.set_adaptive_compression(1e12);
+	writer.add_field("smooth", smooth);
+	REQUIRE(writer.write_mesh("test_adaptive.hdf", pts, vertices, CellType::Vertex));
+	REQUIRE(writer.last_write_stats().arrays.size() == 1);
+	REQUIRE(writer.last_write_stats().arrays[0].level == 0);
+	REQUIRE(hdf5_storage_size("test_adaptive.hdf", "/VTKHDF/PointData/smooth") == n * sizeof(double));
+}
+
+TEST_CASE("output_governor", "[utils]")
+{
+	Eigen::MatrixXd pts(4, 3);
+	pts << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1;
+	Eigen::MatrixXi tets(1, 4);
+	tets << 0, 1, 2, 3;
+
+	VTUWriter vtu;
+	FilteredWriter writer(vtu);
+
+	// Simulated time: a solver step takes 1s, a full write 0.5s and a boundary write 0.02s
+	double now = 0;
+	OutputGovernor governor(0.05);
+	governor.set_clock([&now]() { return now; });
+	governor.set_levels(1, [&](const int level) { writer.set_boundary_only(level >= 1); });
+
+	const int n_steps = 200;
+	for (int step = 0; step < n_steps; ++step)
+	{
+		now += 1;
+		governor.write_step(step * 0.1, [&]() {
+			const std::string path = "test_governor_" + std::to_string(step) + ".vtu";
+			now += governor.level() == 0 ? 0.5 : 0.02;
+			return writer.write_mesh(path, pts, tets, CellType::Tetrahedron) ? path : "";
+		});
+
+		// Never more than one write over the budget
+		REQUIRE(governor.output_seconds() <= 0.05 * governor.elapsed_seconds() + 0.5);
+	}
+
+	REQUIRE(governor.dropped_steps() > 0);
+	REQUIRE(governor.files().size() + governor.dropped_steps() == n_steps);
+	// The cheap level writes more steps than the budget allows full writes
+	REQUIRE(governor.files().size() > 0.05 * n_steps / 0.5);
+	REQUIRE(std::count(governor.levels().begin(), governor.levels().end(), 1) > 0);
+	REQUIRE(governor.levels().front() == 0);
+
+	governor.save_pvd("test_governor.pvd");
+	std::ifstream pvd("test_governor.pvd");
+	const std::string content((std::istreambuf_iterator<char>(pvd)), std::istreambuf_iterator<char>());
+	REQUIRE(content.find(governor.files().back()) != std::string::npos);
+	size_t n_datasets = 0;
+	for (size_t pos = content.find("<DataSet"); pos != std::string::npos; pos = content.find("<DataSet", pos + 1))
+		++n_datasets;
+	REQUIRE(n_datasets == governor.files().size());
+}
+
+TEST_CASE("parallel_for", "[utils]")
+{
+	const int64_t n = 1 << 20;
+	std::vector<int64_t> values(n, 0);
+
+	// Repeated and nested loops run on the same workers (other tests may have started more already)
+	const int n_workers = std::max(3, ThreadPool::instance().n_workers());
+	for (int i = 0; i < 50; ++i)
+	{
+		parallel_for(n, 4, [&](const int64_t begin, const int64_t end) {
+			parallel_for(end - begin, 2, [&](const int64_t b, const int64_t e) {
+				for (int64_t k = begin + b; k < begin + e; ++k)
+					values[k] += k;
+			});
+		});
+	}
+	for (int64_t k = 0; k < n; k += 4099)
+		REQUIRE(values[k] == 50 * k);
+	REQUIRE(ThreadPool::instance().n_workers() == n_workers);
+
+	std::vector<int64_t> prefix(n + 1);
+	REQUIRE(parallel_exclusive_scan<int64_t>(n, 4, [](const int64_t i) { return i % 3; }, prefix.data()) == (n / 3) * 3);
+	REQUIRE(prefix[7] == 0 + 1 + 2 + 0 + 1 + 2 + 0);
+
+	// The exception of any range reaches the caller, once all the ranges are done
+	REQUIRE_THROWS_AS(parallel_for(n, 4, [&](const int64_t begin, const int64_t) {
+		if (begin > 0)
+			throw std::runtime_error("range");
+	}), std::runtime_error);
+}
+
+TEST_CASE("workspace", "[utils]")
+{
+	Workspace workspace;
+	{
+		Workspace::Scope scope(workspace);
+		double *a = workspace.allocate<double>(1 << 20);
+		int64_t *b = workspace.allocate<int64_t>(1 << 20);
+		REQUIRE(reinterpret_cast<size_t>(b) % alignof(int64_t) == 0);
+		a[(1 << 20) - 1] = b[0] = 1;
+	}
+	REQUIRE(workspace.n_allocations() == 2);
+	// Merged into one block of the high-water mark
+	workspace.reset();
+	REQUIRE(workspace.n_allocations() == 3);
+	workspace.allocate<double>(1 << 20);
+	workspace.allocate<int64_t>(1 << 20);
+	REQUIRE(workspace.n_allocations() == 3);
+
+	const int n = 100000;
+	const Eigen::MatrixXd pts = Eigen::MatrixXd::Random(n, 3);
+	std::vector<CellElement> cells(n - 1);
+	for (int i = 0; i < n - 1; ++i)
+	{
+		cells[i].vertices = {i, i + 1};
+		cells[i].ctype = CellType::Line;
+	}
+	const Eigen::MatrixXd u = Eigen::MatrixXd::Random(n, 2);
+
+	VTUWriter vtu;
+	HDF5VTUWriter hdf5;
+	HDF5VTIWriter vti;
+	HDF5VTPWriter vtp;
+	const Eigen::Vector3i grid(100, 100, 10);
+	const auto norm = [&](const int64_t begin, const int64_t end, double *out) {
+		for (int64_t i = begin; i < end; ++i)
+			*out++ = u.row(i).norm();
+	};
+	// Time steps: the first writes size the workspace, then nothing is allocated anymore
+	std::string first, first_vti, first_vtp;
+	for (int step = 0; step < 3; ++step)
+	{
+		// The field nodes are kept by clear and reused by the next step
+		MemorySink image, particles;
+		vti.add_field("u", u);
+		vti.add_field("norm", n, 1, norm);
+		REQUIRE(vti.write_mesh(image, Eigen::Vector3d::Zero(), Eigen::Vector3d::Ones(), grid));
+		vtp.add_field("u", u);
+		vtp.add_field("norm", n, 1, norm);
+		REQUIRE(vtp.write_points(particles, pts));
+		if (step == 0)
+		{
+			first_vti.assign(image.buffer().begin(), image.buffer().end());
+			first_vtp.assign(particles.buffer().begin(), particles.buffer().end());
+		}
+		else
+		{
+			REQUIRE(std::string(image.buffer().begin(), image.buffer().end()) == first_vti);
+			REQUIRE(std::string(particles.buffer().begin(), particles.buffer().end()) == first_vtp);
+		}
+
+		MemorySink memory;
+		vtu.add_field("u", u);
+		vtu.add_field("norm", n, 1, [&](const int64_t begin, const int64_t end, double *out) {
+			for (int64_t i = begin; i < end; ++i)
+				*out++ = u.row(i).norm();
+		});
+		REQUIRE(vtu.write_mesh(memory, pts, cells));
+		if (step == 0)
+			first.assign(memory.buffer().begin(), memory.buffer().end());
+		else
+			REQUIRE(std::string(memory.buffer().begin(), memory.buffer().end()) == first);
+
+		hdf5.add_field("u", u);
+		REQUIRE(hdf5.write_mesh("test_workspace.hdf", pts, cells));
+	}
+	REQUIRE(vtu.last_write_stats().allocations == 0);
+	REQUIRE(vtu.last_write_stats().workspace_bytes > 0);
+	REQUIRE(hdf5.last_write_stats().allocations == 0);
+	REQUIRE(hdf5_read<int64_t>("test_workspace.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64).back() == n - 1);
+	REQUIRE(vti.last_write_stats().allocations == 0);
+	REQUIRE(vtp.last_write_stats().allocations == 0);
+
+	// Fewer fields than the nodes kept: only the fields of this write are written
+	MemorySink recycled, fresh;
+	vtp.add_field("norm", n, 1, norm);
+	REQUIRE(vtp.write_points(recycled, pts));
+	HDF5VTPWriter vtp_fresh;
+	vtp_fresh.add_field("norm", n, 1, norm);
+	REQUIRE(vtp_fresh.write_points(fresh, pts));
+	REQUIRE(recycled.buffer() == fresh.buffer());
+
+	// Shared by writers used in turn
+	Workspace shared;
+	vtu.set_workspace(&shared);
+	hdf5.set_workspace(&shared);
+	MemorySink memory;
+	vtu.add_field("u", u);
+	REQUIRE(vtu.write_mesh(memory, pts, cells));
+	REQUIRE(hdf5.write_mesh("test_workspace.hdf", pts, cells));
+	REQUIRE(shared.n_allocations() > 0);
+	REQUIRE(hdf5.last_write_stats().workspace_bytes == shared.capacity());
+}
+
+TEST_CASE("writer_pool", "[utils]")
+{
+	const int n_members = 12;
+	Eigen::MatrixXd pts(4, 3);
+	pts << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1;
+	Eigen::MatrixXi tets(1, 4);
+	tets << 0, 1, 2, 3;
+
+	std::vector<std::string> expected(n_members);
+	for (int m = 0; m < n_members; ++m)
+	{
+		VTUWriter writer;
+		MemorySink memory;
+		writer.add_field("u", Eigen::MatrixXd::Constant(4, 1, m));
+		REQUIRE(writer.write_mesh(memory, pts, tets, CellType::Tetrahedron));
+		expected[m].assign(memory.buffer().begin(), memory.buffer().end());
+	}
+
+	{
+		// Fewer pending jobs than members: submit blocks until a worker is free
+		WriterPool pool([]() { return std::make_unique<VTUWriter>(); }, 4, 2);
+		std::vector<std::future<bool>> done;
+		for (int m = 0; m < n_members; ++m)
+		{
+			WriteJob job;
+			job.path = "test_pool_" + std::to_string(m) + ".vtu";
+			job.points = pts;
+			job.cells = tets;
+			job.ctype = CellType::Tetrahedron;
+			job.point_fields.emplace_back("u", Eigen::MatrixXd::Constant(4, 1, m));
+			done.push_back(pool.submit(std::move(job)));
+		}
+		for (auto &d : done)
+			REQUIRE(d.get());
+
+		// Errors of a job are reported by its future only
+		std::future<bool> failed = pool.submit([](ParaviewWriter &) -> bool { throw std::runtime_error("job"); });
+		REQUIRE_THROWS_AS(failed.get(), std::runtime_error);
+		pool.wait();
+	}
+
+	for (int m = 0; m < n_members; ++m)
+	{
+		std::ifstream file("test_pool_" + std::to_string(m) + ".vtu", std::ios::binary);
+		REQUIRE(std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()) == expected[m]);
+	}
+
+	WriterPool hdf5([]() { return std::make_unique<HDF5VTUWriter>(); }, 3);
+	for (int m = 0; m < n_members; ++m)
+	{
+		WriteJob job;
+		job.path = "test_pool_" + std::to_string(m) + ".hdf";
+		job.points = pts;
+		job.cells = tets;
+		job.ctype = CellType::Tetrahedron;
+		job.cell_fields.emplace_back("c", Eigen::MatrixXd::Constant(1, 1, m));
+		hdf5.submit(std::move(job));
+	}
+	hdf5.wait();
+	for (int m = 0; m < n_members; ++m)
+		REQUIRE(hdf5_read<double>("test_pool_" + std::to_string(m) + ".hdf", "/VTKHDF/CellData/c", H5T_NATIVE_DOUBLE) == std::vector<double>{double(m)});
+}
+
+TEST_CASE("hdf5_collection", "[utils]")
+{
+	Eigen::MatrixXd pts(4, 3);
+	pts << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1;
+	Eigen::MatrixXi tets(1, 4);
+	tets << 0, 1, 2, 3;
+	Eigen::MatrixXi tris(2, 3);
+	tris << 0, 1, 2, 0, 2, 3;
+	const Eigen::MatrixXd u = Eigen::MatrixXd::Random(4, 1);
+
+	{
+		HDF5CollectionWriter writer;
+		REQUIRE(writer.open("test_collection.hdf"));
+		writer.add_field("u", u);
+		REQUIRE(writer.write_block("fluid", pts, tets, CellType::Tetrahedron));
+		writer.add_cell_field("c", Eigen::MatrixXd::Ones(2, 1));
+		REQUIRE(writer.write_block("walls/inner", pts, tris, CellType::Triangle));
+		REQUIRE(!writer.write_block("fluid", pts, tets, CellType::Tetrahedron));
+		REQUIRE(writer.close());
+	}
+	REQUIRE(hdf5_read<double>("test_collection.hdf", "/VTKHDF/fluid/PointData/u", H5T_NATIVE_DOUBLE) == std::vector<double>(u.data(), u.data() + 4));
+	// The assembly links to the blocks
+	REQUIRE(hdf5_read<int64_t>("test_collection.hdf", "/VTKHDF/Assembly/walls/inner/Connectivity", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 1, 2, 0, 2, 3});
+	REQUIRE(hdf5_read<double>("test_collection.hdf", "/VTKHDF/Assembly/walls/inner/CellData/c", H5T_NATIVE_DOUBLE) == std::vector<double>{1, 1});
+
+	// Leaves with the same name, and a reserved one
+	{
+		HDF5CollectionWriter writer;
+		REQUIRE(writer.open("test_collection_leaves.hdf"));
+		writer.add_cell_field("c", Eigen::MatrixXd::Constant(1, 1, 1));
+		REQUIRE(writer.write_block("fluid/inlet", pts, tets, CellType::Tetrahedron));
+		writer.add_cell_field("c", Eigen::MatrixXd::Constant(2, 1, 2));
+		REQUIRE(writer.write_block("solid/inlet", pts, tris, CellType::Triangle));
+		writer.add_cell_field("c", Eigen::MatrixXd::Constant(1, 1, 3));
+		REQUIRE(writer.write_block("Steps", pts, tets, CellType::Tetrahedron));
+		REQUIRE(writer.close());
+	}
+	REQUIRE(hdf5_read<double>("test_collection_leaves.hdf", "/VTKHDF/Assembly/fluid/inlet/CellData/c", H5T_NATIVE_DOUBLE) == std::vector<double>{1});
+	REQUIRE(hdf5_read<double>("test_collection_leaves.hdf", "/VTKHDF/Assembly/solid/inlet/CellData/c", H5T_NATIVE_DOUBLE) == std::vector<double>{2, 2});
+	REQUIRE(hdf5_read<double>("test_collection_leaves.hdf", "/VTKHDF/Assembly/Steps/CellData/c", H5T_NATIVE_DOUBLE) == std::vector<double>{3});
+	REQUIRE(hdf5_read<int64_t>("test_collection_leaves.hdf", "/VTKHDF/inlet_1/Connectivity", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 1, 2, 0, 2, 3});
+
+	for (const bool static_mesh : {true, false})
+	{
+		HDF5CollectionWriter writer(HDF5CollectionWriter::Type::MultiBlockDataSet);
+		writer.set_static_mesh(static_mesh);
+		REQUIRE(writer.open("test_collection_transient.hdf", true));
+		for (int step = 0; step < 3; ++step)
+		{
+			writer.begin_step(0.5 * step);
+			writer.add_field("u", Eigen::MatrixXd::Constant(4, 1, step));
+			REQUIRE(writer.write_block("fluid", pts, tets, CellType::Tetrahedron));
+			REQUIRE(writer.write_block("walls/inner", pts, tris, CellType::Triangle));
+		}
+		REQUIRE(writer.close());
+
+		const std::string path = "test_collection_transient.hdf";
+		REQUIRE(hdf5_read<double>(path, "/VTKHDF/Steps/Values", H5T_NATIVE_DOUBLE) == std::vector<double>{0, 0.5, 1});
+		REQUIRE(hdf5_read<double>(path, "/VTKHDF/fluid/PointData/u", H5T_NATIVE_DOUBLE) == std::vector<double>{0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2});
+		REQUIRE(hdf5_read<int64_t>(path, "/VTKHDF/fluid/Steps/PointDataOffsets/u", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 4, 8});
+		REQUIRE(hdf5_read<int64_t>(path, "/VTKHDF/Assembly/walls/inner/Steps/NumberOfParts", H5T_NATIVE_INT64) == std::vector<int64_t>{1, 1, 1});
+
+		if (static_mesh)
+		{
+			REQUIRE(hdf5_read<double>(path, "/VTKHDF/fluid/Points", H5T_NATIVE_DOUBLE).size() == 12);
+			REQUIRE(hdf5_read<int64_t>(path, "/VTKHDF/fluid/Steps/PointOffsets", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 0, 0});
+			REQUIRE(hdf5_read<int64_t>(path, "/VTKHDF/fluid/NumberOfCells", H5T_NATIVE_INT64) == std::vector<int64_t>{1});
+		}
+		else
+		{
+			REQUIRE(hdf5_read<double>(path, "/VTKHDF/fluid/Points", H5T_NATIVE_DOUBLE).size() == 36);
+			REQUIRE(hdf5_read<int64_t>(path, "/VTKHDF/inner/Steps/PointOffsets", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 4, 8});
+			REQUIRE(hdf5_read<int64_t>(path, "/VTKHDF/inner/Steps/CellOffsets", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 2, 4});
+			REQUIRE(hdf5_read<int64_t>(path, "/VTKHDF/inner/Steps/ConnectivityIdOffsets", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 6, 12});
+			REQUIRE(hdf5_read<int64_t>(path, "/VTKHDF/inner/Steps/PartOffsets", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 1, 2});
+			REQUIRE(hdf5_read<int64_t>(path, "/VTKHDF/inner/Offsets", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 3, 6, 0, 3, 6, 0, 3, 6});
+		}
+	}
+}
+
+TEST_CASE("tensor_fields", "[utils]")
+{
+	Eigen::MatrixXd pts(3, 2);
+	pts << 0, 0, 1, 0, 0, 1;
+	Eigen::MatrixXi tris(1, 3);
+	tris << 0, 1, 2;
+
+	// 2D symmetric stresses (xx, yy, xy) and a full 2D cell tensor
+	Eigen::MatrixXd sigma(3, 3);
+	sigma << 1, 2, 3, 4, 5, 6, 7, 8, 9;
+	Eigen::MatrixXd grad(1, 4);
+	grad << 1, 2, 3, 4;
+
+	VTUWriter ascii(false);
+	ascii.add_tensor_field("sigma", sigma, TensorLayout::Symmetric2D);
+	ascii.add_tensor_cell_field("grad", grad, TensorLayout::Full2D);
+	MemorySink memory;
+	REQUIRE(ascii.write_mesh(memory, pts, tris, CellType::Triangle));
+	const std::string content(memory.buffer().begin(), memory.buffer().end());
+	REQUIRE(content.find("<PointData Tensors=\"sigma\" >") != std::string::npos);
+	REQUIRE(content.find("<CellData Tensors=\"grad\" >") != std::string::npos);
+	REQUIRE(content.find("Name=\"sigma\" NumberOfComponents=\"6\"") != std::string::npos);
+	REQUIRE(content.find("Name=\"grad\" NumberOfComponents=\"9\"") != std::string::npos);
+
+	HDF5VTUWriter writer;
+	writer.add_tensor_field("sigma", sigma, TensorLayout::Symmetric2D);
+	writer.add_tensor_cell_field("grad", grad, TensorLayout::Full2D);
+	Eigen::MatrixXd full(3, 9);
+	full.setRandom();
+	writer.add_tensor_field("full", full, TensorLayout::Full);
+	REQUIRE(writer.write_mesh("test_tensors.hdf", pts, tris, CellType::Triangle));
+
+	REQUIRE(hdf5_dims("test_tensors.hdf", "/VTKHDF/PointData/sigma") == std::vector<hsize_t>{3, 6});
+	REQUIRE(hdf5_read<double>("test_tensors.hdf", "/VTKHDF/PointData/sigma", H5T_NATIVE_DOUBLE) == std::vector<double>{1, 2, 0, 3, 0, 0, 4, 5, 0, 6, 0, 0, 7, 8, 0, 9, 0, 0});
+	REQUIRE(hdf5_read<double>("test_tensors.hdf", "/VTKHDF/CellData/grad", H5T_NATIVE_DOUBLE) == std::vector<double>{1, 2, 0, 3, 4, 0, 0, 0, 0});
+
+	const Eigen::MatrixXd full_rows = full.transpose();
+	REQUIRE(hdf5_read<double>("test_tensors.hdf", "/VTKHDF/PointData/full", H5T_NATIVE_DOUBLE) == std::vector<double>(full_rows.data(), full_rows.data() + full_rows.size()));
+}
+
+TEST_CASE("node_ordering", "[utils]")
+{
+	Eigen::MatrixXd pts(10, 3);
+	pts << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1,
+		0.5, 0, 0, 0.5, 0.5, 0, 0, 0.5, 0, 0, 0, 0.5, 0, 0.5, 0.5, 0.5, 0, 0.5;
+	// Gmsh tet10: the last two edges are (3, 2) and (3, 1)
+	Eigen::MatrixXi gmsh(1, 10);
+	gmsh << 0, 1, 2, 3, 4, 5, 6, 7, 8, 9;
+	Eigen::MatrixXi vtk(1, 10);
+	vtk << 0, 1, 2, 3, 4, 5, 6, 7, 9, 8;
+	const std::vector<int64_t> expected = {0, 1, 2, 3, 4, 5, 6, 7, 9, 8};
+
+	VTUWriter ascii(false);
+	ascii.set_node_ordering(NodeOrdering::Gmsh);
+	MemorySink memory;
+	REQUIRE(ascii.write_mesh(memory, pts, gmsh, CellType::Tetrahedron));
+	const std::string content(memory.buffer().begin(), memory.buffer().end());
+	REQUIRE(content.find("format=\"ascii\">\n0\n1\n2\n3\n4\n5\n6\n7\n9\n8\n</DataArray>") != std::string::npos);
+
+	HDF5VTUWriter writer;
+	writer.set_node_ordering(NodeOrdering::Gmsh);
+	REQUIRE(writer.write_mesh("test_gmsh.hdf", pts, gmsh, CellType::Tetrahedron));
+	REQUIRE(hdf5_read<int64_t>("test_gmsh.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64) == expected);
+
+	// Mixed elements: the linear triangle is not permuted
+	std::vector<CellElement> elements(2);
+	elements[0].vertices = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+	elements[0].ctype = CellType::Tetrahedron;
+	elements[1].vertices = {0, 1, 2};
+	elements[1].ctype = CellType::Triangle;
+	REQUIRE(writer.write_mesh("test_gmsh.hdf", pts, elements));
+	REQUIRE(hdf5_read<int64_t>("test_gmsh.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 1, 2, 3, 4, 5, 6, 7, 9, 8, 0, 1, 2});
+
+	// Filters see the cells in the VTK order
+	VTUWriter target_gmsh(false), target_vtk(false);
+	FilteredWriter filtered_gmsh(target_gmsh), filtered_vtk(target_vtk);
+	filtered_gmsh.set_boundary_only(true);
+	filtered_gmsh.set_node_ordering(NodeOrdering::Gmsh);
+	filtered_vtk.set_boundary_only(true);
+	MemorySink boundary_gmsh, boundary_vtk;
+	REQUIRE(filtered_gmsh.write_mesh(boundary_gmsh, pts, gmsh, CellType::Tetrahedron));
+	REQUIRE(filtered_vtk.write_mesh(boundary_vtk, pts, vtk, CellType::Tetrahedron));
+	REQUIRE(boundary_gmsh.buffer() == boundary_vtk.buffer());
+
+	// Application ordering
+	register_node_permutation(NodeOrdering::Custom, CellType::Triangle, 3, {0, 2, 1});
+	REQUIRE_THROWS_AS(register_node_permutation(NodeOrdering::Custom, CellType::Triangle, 3, {0, 1, 1}), std::invalid_argument);
+	REQUIRE(node_permutation(NodeOrdering::Gmsh, CellType::Triangle, 6) == nullptr);
+	Eigen::MatrixXi tri(1, 3);
+	tri << 0, 1, 2;
+	writer.set_node_ordering(NodeOrdering::Custom);
+	REQUIRE(writer.write_mesh("test_gmsh.hdf", pts, tri, CellType::Triangle));
+	REQUIRE(hdf5_read<int64_t>("test_gmsh.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 2, 1});
+}
+
+TEST_CASE("polyhedra", "[utils]")
+{
+	// Chain of cubes along x sharing their x faces, enough for the faces to span several encoding blocks
+	const int n = 20000;
+	Eigen::MatrixXd pts(4 * (n + 1), 3);
+	for (int i = 0; i <= n; ++i)
+		for (int k = 0; k < 4; ++k)
+			pts.row(4 * i + k) << i, k / 2, k % 2;
+
+	PolyhedralCells cells;
+	for (int i = 0; i <= n; ++i)
+	{
+		cells.face_vertices.insert(cells.face_vertices.end(), {4 * i, 4 * i + 1, 4 * i + 3, 4 * i + 2});
+		cells.face_offsets.push_back(cells.face_vertices.size());
+	}
+	std::vector<int64_t> expected_faces;
+	for (int i = 0; i < n; ++i)
+	{
+		const int64_t a = 4 * i, b = 4 * (i + 1);
+		const std::vector<std::vector<int64_t>> sides = {{a, b, b + 1, a + 1}, {a + 2, a + 3, b + 3, b + 2}, {a, a + 2, b + 2, b}, {a + 1, b + 1, b + 3, a + 3}};
+		cells.cell_faces.push_back(i);
+		cells.cell_faces.push_back(i + 1);
+		expected_faces.push_back(6);
+		for (const int64_t x : {i, i + 1})
+		{
+			expected_faces.push_back(4);
+			expected_faces.insert(expected_faces.end(), cells.face_vertices.begin() + 4 * x, cells.face_vertices.begin() + 4 * x + 4);
+		}
+		for (const auto &side : sides)
+		{
+			cells.cell_faces.push_back(cells.n_faces());
+			cells.face_vertices.insert(cells.face_vertices.end(), side.begin(), side.end());
+			cells.face_offsets.push_back(cells.face_vertices.size());
+			expected_faces.push_back(4);
+			expected_faces.insert(expected_faces.end(), side.begin(), side.end());
+		}
+		cells.cell_offsets.push_back(cells.cell_faces.size());
+	}
+
+	const auto ascii_array = [](const std::string &content, const std::string &name) {
+		const size_t start = content.find(">", content.find("Name=\"" + name + "\"")) + 1;
+		std::istringstream values(content.substr(start, content.find("</DataArray>", start) - start));
+		std::vector<int64_t> array;
+		int64_t v;
+		while (values >> v)
+			array.push_back(v);
+		return array;
+	};
+
+	VTUWriter ascii(false);
+	ascii.set_num_threads(4);
+	ascii.add_cell_field("id", Eigen::VectorXd::LinSpaced(n, 0, n - 1));
+	MemorySink memory;
+	REQUIRE(ascii.write_mesh(memory, pts, cells));
+	const std::string content(memory.buffer().begin(), memory.buffer().end());
+	REQUIRE(ascii_array(content, "faces") == expected_faces);
+	const std::vector<int64_t> face_offsets = ascii_array(content, "faceoffsets");
+	REQUIRE(face_offsets.size() == n);
+	REQUIRE(face_offsets.back() == int64_t(expected_faces.size()));
+	const std::vector<int64_t> connectivity = ascii_array(content, "connectivity");
+	REQUIRE(std::vector<int64_t>(connectivity.begin(), connectivity.begin() + 8) == std::vector<int64_t>{0, 1, 2, 3, 4, 5, 6, 7});
+	REQUIRE(ascii_array(content, "types") == std::vector<int64_t>(n, 42));
+
+	HDF5VTUWriter writer;
+	writer.set_num_threads(4);
+	REQUIRE(writer.write_mesh("test_polyhedra.hdf", pts, cells));
+	REQUIRE(hdf5_read<int64_t>("test_polyhedra.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64) == connectivity);
+	REQUIRE(hdf5_read<int64_t>("test_polyhedra.hdf", "/VTKHDF/Offsets", H5T_NATIVE_INT64).back() == 8 * n);
+	REQUIRE(hdf5_read<int64_t>("test_polyhedra.hdf", "/VTKHDF/FaceConnectivity", H5T_NATIVE_INT64) == cells.face_vertices);
+	REQUIRE(hdf5_read<int64_t>("test_polyhedra.hdf", "/VTKHDF/FaceOffsets", H5T_NATIVE_INT64) == cells.face_offsets);
+	REQUIRE(hdf5_read<int64_t>("test_polyhedra.hdf", "/VTKHDF/PolyhedronToFaces", H5T_NATIVE_INT64) == cells.cell_faces);
+	REQUIRE(hdf5_read<int64_t>("test_polyhedra.hdf", "/VTKHDF/PolyhedronOffsets", H5T_NATIVE_INT64) == cells.cell_offsets);
+	REQUIRE(hdf5_read<int64_t>("test_polyhedra.hdf", "/VTKHDF/NumberOfFaces", H5T_NATIVE_INT64) == std::vector<int64_t>{cells.n_faces()});
+}
+
+TEST_CASE("weld_points", "[utils]")
+{
+	// Discontinuous output: two triangles with their own copies of the shared edge, and an unused point
+	Eigen::MatrixXd pts(7, 2);
+	pts << 0, 0, 1, 0, 0, 1,
+		1, 0, 1, 1, 0, 1,
+		5, 5;
+	Eigen::MatrixXi tris(2, 3);
+	tris << 0, 1, 2, 3, 4, 5;
+	Eigen::MatrixXd u(7, 1);
+	u << 1, 2, 3, 4, 5, 6, 7;
+
+	HDF5VTUWriter target;
+	FilteredWriter writer(target);
+	writer.set_welding(true);
+	writer.add_field("u", u);
+	writer.add_cell_field("c", Eigen::Vector2d(10, 20));
+	REQUIRE(writer.write_mesh("test_weld.hdf", pts, tris, CellType::Triangle));
+	REQUIRE(hdf5_read<int64_t>("test_weld.hdf", "/VTKHDF/NumberOfPoints", H5T_NATIVE_INT64) == std::vector<int64_t>{4});
+	REQUIRE(hdf5_read<int64_t>("test_weld.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 1, 2, 1, 3, 2});
+	REQUIRE(hdf5_read<double>("test_weld.hdf", "/VTKHDF/PointData/u", H5T_NATIVE_DOUBLE) == std::vector<double>{1, 3, 4.5, 5});
+	REQUIRE(hdf5_read<double>("test_weld.hdf", "/VTKHDF/CellData/c", H5T_NATIVE_DOUBLE) == std::vector<double>{10, 20});
+
+	// Within a tolerance, keeping the value of the first point
+	Eigen::MatrixXd noisy = pts;
+	noisy.block(3, 0, 3, 2).array() += 1e-9;
+	writer.set_welding(true, 1e-6, PointMerge::First);
+	writer.add_field("u", u);
+	REQUIRE(writer.write_mesh("test_weld.hdf", noisy, tris, CellType::Triangle));
+	REQUIRE(hdf5_read<double>("test_weld.hdf", "/VTKHDF/PointData/u", H5T_NATIVE_DOUBLE) == std::vector<double>{1, 2, 3, 5});
+
+	// Pruning only
+	writer.set_welding(false);
+	writer.set_pruning(true);
+	REQUIRE(writer.write_mesh("test_weld.hdf", pts, tris, CellType::Triangle));
+	REQUIRE(hdf5_read<int64_t>("test_weld.hdf", "/VTKHDF/NumberOfPoints", H5T_NATIVE_INT64) == std::vector<int64_t>{6});
+
+	// Welded before the boundary extraction: the shared face of two tetrahedra is interior
+	Eigen::MatrixXd tet_pts(8, 3);
+	tet_pts << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1,
+		1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 1;
+	Eigen::MatrixXi tets(2, 4);
+	tets << 0, 1, 2, 3, 4, 7, 5, 6;
+	Eigen::VectorXd v = Eigen::VectorXd::LinSpaced(8, 0, 7);
+	FilteredWriter boundary(target);
+	boundary.set_welding(true);
+	boundary.set_boundary_only(true);
+	boundary.set_num_threads(4);
+	boundary.add_field("v", v);
+	REQUIRE(boundary.write_mesh("test_weld.hdf", tet_pts, tets, CellType::Tetrahedron));
+	REQUIRE(hdf5_read<int64_t>("test_weld.hdf", "/VTKHDF/NumberOfCells", H5T_NATIVE_INT64) == std::vector<int64_t>{6});
+	REQUIRE(hdf5_read<int64_t>("test_weld.hdf", "/VTKHDF/NumberOfPoints", H5T_NATIVE_INT64) == std::vector<int64_t>{5});
+	REQUIRE(hdf5_read<double>("test_weld.hdf", "/VTKHDF/PointData/v", H5T_NATIVE_DOUBLE) == std::vector<double>{0, 2.5, 3.5, 4.5, 7});
+
+	// Per element points of a grid, welded in parallel
+	const int n = 100;
+	Eigen::MatrixXd grid(6 * n * n, 2);
+	Eigen::MatrixXi elements(2 * n * n, 3);
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+		{
+			const int e = 6 * (i * n + j);
+			grid.block(e, 0, 6, 2) << i, j, i + 1, j, i, j + 1, i + 1, j, i + 1, j + 1, i, j + 1;
+			elements.row(2 * (i * n + j)) << e, e + 1, e + 2;
+			elements.row(2 * (i * n + j) + 1) << e + 3, e + 4, e + 5;
+		}
+	for (const double tolerance : {0., 0.1})
+	{
+		FilteredMesh welded;
+		weld_points(grid, CellsView(elements, CellType::Triangle), tolerance, 4, welded);
+		REQUIRE(welded.points.rows() == (n + 1) * (n + 1));
+		REQUIRE(welded.merged_offsets.back() == grid.rows());
+	}
+}
+
+TEST_CASE("large_index_dataset", "[utils]")
+{
+	// Chunked dataset past 2^31 entries, only the written chunk is allocated
+	const hsize_t n = (hsize_t(1) << 31) + 8;
+	{
+		HDF5File file;
+		REQUIRE(file.create("test_large_index.hdf"));
+		file.set_compression_level(1);
+		const hid_t dset = file.create_index_dataset("/values", n);
+		std::vector<int64_t> tail(8);
+		for (int i = 0; i < 8; ++i)
+			tail[i] = int64_t(n) - 8 + i;
+		file.write_rows(dset, H5T_NATIVE_INT64, tail.data(), n - 8, 8);
+		file.release_dataset(dset);
+		REQUIRE(file.close());
+	}
+
+	REQUIRE(hdf5_dims("test_large_index.hdf", "/values") == std::vector<hsize_t>{n});
+
+	const hid_t file = H5Fopen("test_large_index.hdf", H5F_ACC_RDONLY, H5P_DEFAULT);
+	const hid_t dset = H5Dopen2(file, "/values", H5P_DEFAULT);
+	const hid_t space = H5Dget_space(dset);
+	const hsize_t start = n - 8, count = 8;
+	H5Sselect_hyperslab(space, H5S_SELECT_SET, &start, nullptr, &count, nullptr);
+	const hid_t mem = H5Screate_simple(1, &count, nullptr);
+	std::vector<int64_t> values(8);
+	H5Dread(dset, H5T_NATIVE_INT64, mem, space, H5P_DEFAULT, values.data());
+	H5Sclose(mem);
+	H5Sclose(space);
+	H5Dclose(dset);
+	H5Fclose(file);
+
+	REQUIRE(values.front() == int64_t(n) - 8);
+	REQUIRE(values.back() == int64_t(n) - 1);
+}
+
+TEST_CASE("writer_index_arrays", "[utils]")
+{
+	// Indices up to the int range go through the writers into Int64 arrays
+	const int big = std::numeric_limits<int>::max();
+	Eigen::MatrixXd pts(4, 3);
+	pts.setRandom();
+	Eigen::MatrixXi tris(2, 3);
+	tris << 0, 1, big,
+		1, 3, 2;
+
+	std::vector<CellElement> cells(2);
+	cells[0].vertices = {0, 1, 3, big};
+	cells[0].ctype = CellType::Quadrilateral;
+	cells[1].vertices = {1, 3, 2};
+	cells[1].ctype = CellType::Triangle;
+
+	VTUWriter ascii(false);
+	MemorySink matrix_vtu, elements_vtu;
+	REQUIRE(ascii.write_mesh(matrix_vtu, pts, tris, CellType::Triangle));
+	REQUIRE(ascii.write_mesh(elements_vtu, pts, cells));
+
+	const std::string matrix_content(matrix_vtu.buffer().begin(), matrix_vtu.buffer().end());
+	REQUIRE(matrix_content.find("<DataArray type=\"Int64\" Name=\"connectivity\" format=\"ascii\">\n0\n1\n2147483647\n1\n3\n2\n</DataArray>") != std::string::npos);
+	REQUIRE(matrix_content.find("<DataArray type=\"Int64\" Name=\"offsets\" format=\"ascii\">\n3\n6\n</DataArray>") != std::string::npos);
+
+	const std::string elements_content(elements_vtu.buffer().begin(), elements_vtu.buffer().end());
+	REQUIRE(elements_content.find("<DataArray type=\"Int64\" Name=\"connectivity\" format=\"ascii\">\n0\n1\n3\n2147483647\n1\n3\n2\n</DataArray>") != std::string::npos);
+	REQUIRE(elements_content.find("<DataArray type=\"Int64\" Name=\"offsets\" format=\"ascii\">\n4\n7\n</DataArray>") != std::string::npos);
+
+	const auto is_int64 = [](const std::string &path, const std::string &dataset) {
+		const hid_t file = H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+		const hid_t dset = H5Dopen2(file, dataset.c_str(), H5P_DEFAULT);
+		const hid_t type = H5Dget_type(dset);
+		const bool ok = H5Tget_class(type) == H5T_INTEGER && H5Tget_size(type) == 8 && H5Tget_sign(type) == H5T_SGN_2;
+		H5Tclose(type);
+		H5Dclose(dset);
+		H5Fclose(file);
+		return ok;
+	};
+
+	HDF5VTUWriter writer;
+	REQUIRE(writer.write_mesh("test_index_matrix.hdf", pts, tris, CellType::Triangle));
+	REQUIRE(writer.write_mesh("test_index_elements.hdf", pts, cells));
+
+	for (const std::string path : {"test_index_matrix.hdf", "test_index_elements.hdf"})
+	{
+		REQUIRE(is_int64(path, "/VTKHDF/Connectivity"));
+		REQUIRE(is_int64(path, "/VTKHDF/Offsets"));
+		REQUIRE(is_int64(path, "/VTKHDF/NumberOfConnectivityIds"));
+	}
+
+	REQUIRE(hdf5_read<int64_t>("test_index_matrix.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 1, big, 1, 3, 2});
+	REQUIRE(hdf5_read<int64_t>("test_index_matrix.hdf", "/VTKHDF/Offsets", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 3, 6});
+	REQUIRE(hdf5_read<int64_t>("test_index_elements.hdf", "/VTKHDF/Connectivity", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 1, 3, big, 1, 3, 2});
+	REQUIRE(hdf5_read<int64_t>("test_index_elements.hdf", "/VTKHDF/Offsets", H5T_NATIVE_INT64) == std::vector<int64_t>{0, 4, 7});
+}
+
+// Streams 2^31 + 3 connectivity entries (about 23 GB of base64), run explicitly with [large]
+TEST_CASE("large_connectivity", "[.][large]")
+{
+	const int64_t n = (int64_t(1) << 31) + 3;
+
+	uint64_t n_bytes = 0;
+	CallbackSink sink([&](const char *data, const size_t size) {
+		n_bytes += size;
+		return true;
+	});
+	{
+		Workspace workspace;
+		SinkStreamBuf buffer(sink);
+		std::ostream os(&buffer);
+		write_vtk_int64_array("connectivity", n, [](const int64_t begin, const int64_t end, int64_t *out) {
+			for (int64_t i = begin; i < end; ++i)
+				*out++ = i;
+		}, true, os, workspace);
+	}
+	sink.flush();
+
+	// Header (8 bytes) and data are encoded in one base64 stream
+	const uint64_t encoded = (8 + n * 8 + 2) / 3 * 4;
+	REQUIRE(n_bytes > encoded);
+	REQUIRE(n_bytes < encoded + 256);
+}